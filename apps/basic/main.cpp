@@ -68,7 +68,7 @@ public:
 
     vertexBuffer.write(vertexData.data());
 
-    WGPUShaderModule shaderModule = ctx.createShaderModule(shaderSource);
+    WGPUShaderModule shaderModule = ctx.pipelineCache.shaderModule(shaderSource);
     pipeline = ctx.createRenderPipeline(new WGPURenderPipelineDescriptor{
       .layout = ctx.createPipelineLayout(new WGPUPipelineLayoutDescriptor{
         .bindGroupLayoutCount = 1,
@@ -125,7 +125,6 @@ public:
         .alphaToCoverageEnabled = false
       }
       });
-    wgpuShaderModuleRelease(shaderModule);
   }
 
   ~Application() {
@@ -2,6 +2,7 @@
 #include "common.hpp"
 #include "primitive.hpp"
 #include "math.hpp"
+#include "quantize.hpp"
 
 struct CameraUniform {
   std::array<float, 16> view;
@@ -10,7 +11,8 @@ struct CameraUniform {
 
 class GnomonGeometry {
 private:
-  std::vector<float> vertices;
+  // baked at compile time and uploaded from read-only data
+  static constexpr auto axes = prim::generateStatic<prim::PositionColor>([] { return prim::Gnomon{ .size = 1 }; });
 
   const char* source = R"(
   struct Camera {
@@ -46,11 +48,10 @@ public:
   WGPU::Geometry geom;
   WGPU::RenderPipeline pipeline;
 
-  GnomonGeometry(WGPU::Context& ctx, const std::vector<WGPU::RenderPipeline::BindGroupEntry>& bindGroups) :
-    vertices(36),
+  GnomonGeometry(WGPU::Context& ctx, const std::vector<WGPUBindGroupLayout>& bindGroupLayouts) :
     vertexBuffer(ctx, {
       .label = "vertex",
-      .size = vertices.size() * sizeof(float),
+      .size = sizeof(axes.vertices),
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
       .mappedAtCreation = false
       }),
@@ -72,11 +73,11 @@ public:
           .stepMode = WGPUVertexStepMode_Vertex
         }
       },
-      .count = 6
+      .count = static_cast<uint32_t>(axes.vertices.size())
       },
     pipeline(ctx, {
       .source = source,
-      .bindGroups = bindGroups,
+      .bindGroupLayouts = bindGroupLayouts,
       .vertex = {
         .entryPoint = "vs",
         .buffers = geom.vertexBuffers,
@@ -110,8 +111,7 @@ public:
     }
       })
   {
-    prim::gnomon(vertices, 1.);
-    geom.vertexBuffers[0].buffer.write(vertices.data());
+    geom.vertexBuffers[0].buffer.write(axes.vertices.data());
   }
 
   void draw(WGPU::RenderPass& pass) {
@@ -122,10 +122,11 @@ public:
 
 class CubeGeometry {
 private:
-  std::vector<float> vertices;
-  std::vector<uint16_t> indices;
+  static constexpr auto cube = prim::generateStatic([] { return prim::Cube{ .size = .5f }; });
 
-  const char* shaderSource = R"(
+  // the cube spans [-.5, .5], positions and normals are uploaded quantized
+  quantize::Bounds bounds{ { 0, 0, 0 }, { .5f, .5f, .5f } };
+  std::string shaderSource = quantize::wgsl(bounds) + R"(
   struct Camera {
     view : mat4x4f,
     proj : mat4x4f,
@@ -140,11 +141,11 @@ private:
   @group(0) @binding(1) var<uniform> model : mat4x4f;
 
   @vertex fn vs(
-    @location(0) position: vec3f,
-    @location(1) normal: vec3f) -> VSOutput {
+    @location(0) position: vec4f,
+    @location(1) normal: vec2f) -> VSOutput {
 
-    let pos = camera.proj * camera.view * model * vec4f(position, 1);
-    return VSOutput(pos, normal);
+    let pos = camera.proj * camera.view * model * vec4f(decodePosition(position), 1);
+    return VSOutput(pos, decodeNormal(normal));
   }
 
   @fragment fn fs(@location(0) normal: vec3f) -> @location(0) vec4f {
@@ -158,18 +159,16 @@ public:
 
   WGPU::RenderPipeline pipeline;
 
-  CubeGeometry(WGPU::Context& ctx, const std::vector<WGPU::RenderPipeline::BindGroupEntry>& bindGroups) :
-    vertices(144),
-    indices(36),
+  CubeGeometry(WGPU::Context& ctx, const std::vector<WGPUBindGroupLayout>& bindGroupLayouts) :
     vertexBuffer(ctx, {
         .label = "vertex",
-        .size = vertices.size() * sizeof(float),
+        .size = cube.vertices.size() * 6 * sizeof(int16_t),
         .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
         .mappedAtCreation = false
       }),
     indexBuffer(ctx, {
       .label = "index",
-      .size = (indices.size() * sizeof(uint16_t) + 3) & ~3, // round up to the next multiple of 4
+      .size = (sizeof(cube.indices) + 3) & ~3, // round up to the next multiple of 4
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
       .mappedAtCreation = false
       }),
@@ -184,19 +183,19 @@ public:
         {
           .buffer = vertexBuffer,
           .attributes = {
-            {.shaderLocation = 0, .format = WGPUVertexFormat_Float32x3, .offset = 0 },
-            {.shaderLocation = 1, .format = WGPUVertexFormat_Float32x3, .offset = 3 * sizeof(float) }
+            {.shaderLocation = 0, .format = WGPUVertexFormat_Snorm16x4, .offset = 0 },
+            {.shaderLocation = 1, .format = WGPUVertexFormat_Snorm16x2, .offset = 4 * sizeof(int16_t) }
           },
-          .arrayStride = 6 * sizeof(float),
+          .arrayStride = 6 * sizeof(int16_t),
           .stepMode = WGPUVertexStepMode_Vertex
         }
       },
       .indexBuffer = indexBuffer,
-      .count = static_cast<uint32_t>(indices.size()),
+      .count = static_cast<uint32_t>(cube.indices.size()),
       },
     pipeline(ctx, {
-      .source = shaderSource,
-      .bindGroups = bindGroups,
+      .source = shaderSource.c_str(),
+      .bindGroupLayouts = bindGroupLayouts,
       .vertex = {
         .entryPoint = "vs",
         .buffers = geom.vertexBuffers,
@@ -231,9 +230,12 @@ public:
       }
     )
   {
-    prim::cube(vertices, indices, .5);
-    geom.vertexBuffers[0].buffer.write(vertices.data());
-    geom.indexBuffer.write(indices.data());
+    size_t count = cube.vertices.size();
+    std::vector<int16_t> packed(count * 6);
+    quantize::encodePositions({ cube.vertices[0].position, 6 }, count, bounds, { packed.data(), 6 });
+    quantize::encodeNormals({ cube.vertices[0].normal, 6 }, count, { packed.data() + 4, 6 });
+    geom.vertexBuffers[0].buffer.write(packed.data());
+    geom.indexBuffer.write(cube.indices.data());
   }
 
   void draw(WGPU::RenderPass& pass) {
@@ -245,7 +247,12 @@ public:
 class Application : public WGPUApplication {
 public:
   WGPU::Buffer uCamera;
-  WGPU::Buffer uModel;
+  // the model matrices of a frame, bound with dynamic offsets
+  WGPU::UniformArena models;
+  // shared by the pipelines of both geometries
+  WGPU::BindGroup cameraGroup;
+  // the uniforms of every frame
+  WGPU::Uploader uploads{ ctx, 64 << 10 };
 
   GnomonGeometry gnomon;
   CubeGeometry cube;
@@ -270,6 +277,8 @@ public:
   struct {
     bool isDown = false;
     Eigen::Vector3f dir = { 0, M_PI_2,1 };
+    // of the last frame
+    WGPU::RenderPass::Counters passCounters;
   } state;
 
   Application() : WGPUApplication(1278, 720),
@@ -279,70 +288,34 @@ public:
         .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
         .mappedAtCreation = false,
       }),
-      uModel(ctx, {
-        .label = "model",
-        .size = sizeof(float) * 16,
-        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-        .mappedAtCreation = false,
-        }),
-        gnomon(ctx, {
-          {
-            .label = "camera",
-            .entries = {
-              {
-                .binding = 0,
-                .buffer = &uCamera,
-                .offset = 0,
-                .visibility = WGPUShaderStage_Vertex,
-                .layout = {
-                  .type = WGPUBufferBindingType_Uniform,
-                  .hasDynamicOffset = false,
-                  .minBindingSize = uCamera.size,
-                  }
-              },
-              {
-                .binding = 1,
-                .buffer = &uModel,
-                .offset = 0,
-                .visibility = WGPUShaderStage_Vertex,
-                .layout = {
-                  .type = WGPUBufferBindingType_Uniform,
-                  .hasDynamicOffset = false,
-                  .minBindingSize = uModel.size,
-                }
-              }
-            }
-          }
-          }),
-    cube(ctx, {
-        {
-          .label = "camera",
-          .entries = {
-            {
-              .binding = 0,
-              .buffer = &uCamera,
-              .offset = 0,
-              .visibility = WGPUShaderStage_Vertex,
-              .layout = {
-                .type = WGPUBufferBindingType_Uniform,
-                .hasDynamicOffset = false,
-                .minBindingSize = uCamera.size,
-                }
-            },
-            {
-              .binding = 1,
-              .buffer = &uModel,
-              .offset = 0,
-              .visibility = WGPUShaderStage_Vertex,
-              .layout = {
-                .type = WGPUBufferBindingType_Uniform,
-                .hasDynamicOffset = false,
-                .minBindingSize = uModel.size,
-              }
-            }
+      models(ctx, 64 << 10, "models"),
+    cameraGroup(ctx, "camera", {
+      {
+        .binding = 0,
+        .buffer = &uCamera,
+        .offset = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .layout = {
+          .type = WGPUBufferBindingType_Uniform,
+          .hasDynamicOffset = false,
+          .minBindingSize = uCamera.size,
           }
+      },
+      {
+        .binding = 1,
+        .buffer = &models.buffer,
+        .offset = 0,
+        .size = sizeof(float) * 16,
+        .visibility = WGPUShaderStage_Vertex,
+        .layout = {
+          .type = WGPUBufferBindingType_Uniform,
+          .hasDynamicOffset = true,
+          .minBindingSize = sizeof(float) * 16,
         }
+      }
       }),
+    gnomon(ctx, { cameraGroup.layout }),
+    cube(ctx, { cameraGroup.layout }),
     orbit(camera.object)
   {
     WGPUTextureFormat depthTextureFormat = WGPUTextureFormat_Depth24Plus;
@@ -369,7 +342,8 @@ public:
     Eigen::Quaternionf rot;
     Eigen::Matrix4f m;
     math::rotation(m, math::betweenZ(rot, math::sph2cart(vec, state.dir)));
-    uModel.write(m.data());
+    uint32_t model = models.push(m);
+    models.upload(uploads);
 
     CameraUniform uniformData{};
     math::perspective(Eigen::Map<Eigen::Matrix4f>(uniformData.proj.data()),
@@ -377,7 +351,7 @@ public:
       camera.perspective.near, camera.perspective.far);
 
     lookAt(Eigen::Map<Eigen::Matrix4f>(uniformData.view.data()), camera.object);
-    uCamera.write(&uniformData);
+    uploads.write(uCamera, 0, &uniformData, sizeof(uniformData));
 
     WGPUTextureView view = ctx.surfaceTextureCreateView();
     std::vector<WGPUCommandBuffer> commands;
@@ -422,9 +396,11 @@ public:
         .depthStencilAttachment = &depthStencilAttachment,
       };
       WGPU::RenderPass pass = encoder.renderPass(&passDescriptor);
+      pass.setBindGroup(0, cameraGroup, model);
       gnomon.draw(pass);
       cube.draw(pass);
       pass.end();
+      state.passCounters = pass.counters;
 
       WGPUCommandBufferDescriptor commandDescriptor{};
       commands.push_back(encoder.finish(&commandDescriptor));
@@ -454,6 +430,9 @@ public:
       ImGui::Begin("Controls");
       ImGui::SliderFloat("phi", &state.dir.x(), 0.0f, M_PI * 2.);
       ImGui::SliderFloat("theta", &state.dir.y(), -M_PI_2, M_PI_2);
+      ImGui_passStats(state.passCounters);
+      ImGui_uploadStats(uploads);
+      ImGui_cacheStats(ctx);
 
       ImGui::End();
     }
@@ -462,6 +441,7 @@ public:
     commands.push_back(ImGui_command(ctx, view));
     wgpuTextureViewRelease(view);
 
+    uploads.flush();
     ctx.submitCommands(commands);
     ctx.releaseCommands(commands);
 
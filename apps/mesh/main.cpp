@@ -1,8 +1,20 @@
+#include <chrono>
+#include <optional>
 #include <SDL3/SDL.h>
 #include "common.hpp"
 #include "primitive.hpp"
 #include "math.hpp"
 #include "read_off.hpp"
+#include "read_obj.hpp"
+#include "read_ply.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimize.hpp"
+#include "mesh_simplify.hpp"
+#include "mesh_meshlet.hpp"
+#include "mesh_bvh.hpp"
+#include "mesh_pipeline.hpp"
+#include "quantize.hpp"
+#include "task.hpp"
 
 struct CameraUniform {
   std::array<float, 16> view;
@@ -11,7 +23,8 @@ struct CameraUniform {
 
 class GnomonGeometry {
 private:
-  std::vector<float> vertices;
+  // baked at compile time and uploaded from read-only data
+  static constexpr auto axes = prim::generateStatic<prim::PositionColor>([] { return prim::Gnomon{ .size = 2 }; });
 
   const char* source = R"(
   struct Camera {
@@ -47,12 +60,10 @@ public:
   WGPU::Geometry geom;
   WGPU::RenderPipeline pipeline;
 
-  GnomonGeometry(WGPU::Context& ctx, const std::vector<WGPU::RenderPipeline::BindGroupEntry>& bindGroups) :
-    vertices(36),
-
+  GnomonGeometry(WGPU::Context& ctx, const std::vector<WGPUBindGroupLayout>& bindGroupLayouts) :
     vertexBuffer(ctx, {
       .label = "vertex",
-      .size = vertices.size() * sizeof(float),
+      .size = sizeof(axes.vertices),
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
       .mappedAtCreation = false
       }),
@@ -74,11 +85,11 @@ public:
           .stepMode = WGPUVertexStepMode_Vertex
         }
       },
-      .count = 6
+      .count = static_cast<uint32_t>(axes.vertices.size())
       },
     pipeline(ctx, {
       .source = source,
-      .bindGroups = bindGroups,
+      .bindGroupLayouts = bindGroupLayouts,
       .vertex = {
         .entryPoint = "vs",
         .buffers = geom.vertexBuffers,
@@ -112,8 +123,7 @@ public:
     }
       })
   {
-    prim::gnomon(vertices, 2.);
-    geom.vertexBuffers[0].buffer.write(vertices.data());
+    geom.vertexBuffers[0].buffer.write(axes.vertices.data());
   }
 
   void draw(WGPU::RenderPass& pass) {
@@ -124,10 +134,31 @@ public:
 
 class MeshGeometry {
 private:
-  std::vector<float> vertices;
-  std::vector<uint16_t> indices;
+  // sizes that have to be known before the buffers are created
+  struct Layout {
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t indexSize;
+    // bounds of the normalized positions, which the quantization is relative to
+    quantize::Bounds bounds;
+  };
+
+  MeshCache cache;
+  Layout layout;
+  std::string shaderSource;
+
+  // quantization error of the uploaded vertices
+  quantize::Error positionError;
+  quantize::Error colorError;
+  quantize::Error normalError;
+
+  // the drawn level of detail and how many of its meshlets survived culling
+  size_t lod = 0;
+  size_t visibleMeshlets = 0;
+  size_t levelMeshlets = 0;
 
-  const char* shaderSource = R"(
+  // follows the decode functions of quantize::wgsl()
+  static constexpr const char* shaderBody = R"(
   struct Camera {
     view : mat4x4f,
     proj : mat4x4f,
@@ -135,50 +166,208 @@ private:
 
   struct VSOutput {
     @builtin(position) position: vec4f,
-    @location(0) normal: vec3f,
+    @location(0) color: vec3f,
+    @location(1) normal: vec3f,
   };
 
   @group(0) @binding(0) var<uniform> camera : Camera;
   @group(0) @binding(1) var<uniform> model : mat4x4f;
 
   @vertex fn vs(
-    @location(0) position: vec3f,
-    @location(1) color: vec3f) -> VSOutput {
+    @location(0) position: vec4f,
+    @location(1) color: vec4f,
+    @location(2) normal: vec2f) -> VSOutput {
 
-    var pos = camera.proj * camera.view * model * vec4f(position, 1);
-    return VSOutput(pos, color);
+    let modelView = camera.view * model;
+    var pos = camera.proj * modelView * vec4f(decodePosition(position), 1);
+    return VSOutput(pos, color.rgb, (modelView * vec4f(decodeNormal(normal), 0)).xyz);
   }
 
-  @fragment fn fs(@location(0) color: vec3f) -> @location(0) vec4f {
-    return vec4f(pow(color, vec3f(2.2)), 1.);
+  // a light at the camera
+  @fragment fn fs(@location(0) color: vec3f, @location(1) normal: vec3f) -> @location(0) vec4f {
+    let diffuse = max(dot(normalize(normal), vec3f(0, 0, 1)), 0.);
+    return vec4f(pow(color, vec3f(2.2)) * (.2 + .8 * diffuse), 1.);
   }
   )";
 public:
   WGPU::Buffer vertexBuffer0;
   WGPU::Buffer vertexBuffer1;
+  WGPU::Buffer vertexBuffer2;
   WGPU::Buffer indexBuffer;
   WGPU::IndexedGeometry geom;
 
   WGPU::RenderPipeline pipeline;
 
-  MeshGeometry(WGPU::Context& ctx, const std::vector<WGPU::RenderPipeline::BindGroupEntry>& bindGroups) :
-    vertices(3395 * 3),
-    indices(6786 * 3),
+  static bool matches(const MeshCache& cache, bool split16) {
+    return cache && (split16 ? cache.header->indexSize == 2 : cache.header->clusterCount == 0);
+  }
+
+  // Parses and preprocesses the whole mesh in memory, welds duplicated
+  // vertices, reorders it for the vertex cache, overdraw and vertex fetch,
+  // computes normals, bakes ambient occlusion into the colors and caches the
+  // result. Meshes
+  // that are not split into clusters get a chain of levels of detail after
+  // the full mesh in the index buffer, each grouped into meshlets that keep
+  // the vertex cache order inside them.
+  static MeshCache parse(const std::string& path, bool split16) {
+    mesh::MeshData data;
+    std::vector<float>& vertices = data.positions, & colors = data.colors, & normals = data.normals;
+    std::vector<uint32_t>& indices = data.indices;
+    bool hasColors = false;
+    bool ok = path.ends_with(".ply") ? readPLY(path, vertices, indices) :
+      path.ends_with(".obj") ? readOBJ(path, vertices, indices) :
+      readOFFLayout<float>(path, [&](const off::Header& header) {
+        hasColors = header.hasColors;
+        vertices.resize(size_t(header.numVertices) * 3);
+        colors.resize(vertices.size());
+        return off::VertexLayout<float>{ .position = { vertices.data(), 3 }, .color = { colors.data(), 3 } };
+        }, indices);
+    if (!ok) throw std::runtime_error("reading mesh failed: " + path);
+
+    // merge the copies exporters leave along seams, within 1e-6 of the
+    // unit-sized mesh, and bake ambient occlusion into the colors once here
+    // so it is cached with them
+    mesh::WeldStats weld{};
+    mesh::Pipeline pipeline;
+    pipeline.then(mesh::passes::normalize());
+    if (!hasColors) pipeline.then(mesh::passes::colorFromBounds());
+    pipeline
+      .then(mesh::passes::weld(1e-6f, &weld))
+      .then(mesh::passes::optimize())
+      .then(mesh::passes::normals())
+      .then(mesh::passes::occlusion());
+    if (!pipeline.run(data, 0, [](const std::string& name, double seconds) { SDL_Log("%s: %.3fs", name.c_str(), seconds); }))
+      throw std::runtime_error("preprocessing failed: " + path);
+    SDL_Log("weld: %zu vertices, %zu after merging duplicates", weld.before, weld.after);
+    size_t count = data.vertexCount();
+
+    if (fitsUint16(count) || !split16) {
+      auto lods = mesh::buildLods(indices, vertices.data(), count, { colors.data(), 3, 3, .01f });
+      std::vector<mesh::Meshlet> meshlets;
+      for (auto& lod : lods) {
+        auto level = indices.begin() + lod.firstIndex;
+        std::vector<uint32_t> source(level, level + lod.indexCount);
+        auto built = mesh::buildMeshlets(source.data(), source.size(), vertices.data(), count, &*level, 64, 124, lod.firstIndex);
+        mesh::optimizeMeshlets(built.data(), built.size(), indices.data());
+        meshlets.insert(meshlets.end(), built.begin(), built.end());
+      }
+      if (fitsUint16(count))
+        return MeshCache::build(path, vertices, colors, normals, std::vector<uint16_t>(indices.begin(), indices.end()), {},
+          lods, meshlets);
+      return MeshCache::build(path, vertices, colors, normals, indices, {}, lods, meshlets);
+    }
+
+    std::vector<uint16_t> local;
+    std::vector<uint32_t> remap;
+    auto clusters = mesh::split16(indices.data(), indices.size(), count, local, remap);
+    std::vector<float> splitVertices(remap.size() * 3), splitColors(remap.size() * 3), splitNormals(remap.size() * 3);
+    mesh::remapStream(vertices.data(), 3, remap, splitVertices.data());
+    mesh::remapStream(colors.data(), 3, remap, splitColors.data());
+    mesh::remapStream(normals.data(), 3, remap, splitNormals.data());
+    return MeshCache::build(path, splitVertices, splitColors, splitNormals, local, clusters);
+  }
+
+  // Calls fn(indices, count) with the triangles of the full level of detail.
+  // Split caches index relative to the base vertex of their cluster, so
+  // their indices are made global first.
+  template <typename Fn>
+  static void withIndices(const MeshCache& source, Fn&& fn) {
+    const MeshCache::Header& h = *source.header;
+    size_t count = h.lodCount ? source.lods[0].indexCount : h.indexCount;
+    if (h.clusterCount) {
+      std::vector<uint32_t> global(count);
+      const uint16_t* local = static_cast<const uint16_t*>(source.indices);
+      for (size_t c = 0; c < h.clusterCount; c++) {
+        const mesh::Cluster& cluster = source.clusters[c];
+        for (uint32_t i = cluster.firstIndex; i < cluster.firstIndex + cluster.indexCount; i++)
+          global[i] = local[i] + cluster.baseVertex;
+      }
+      fn(global.data(), count);
+    }
+    else if (h.indexSize == 2) fn(static_cast<const uint16_t*>(source.indices), count);
+    else fn(static_cast<const uint32_t*>(source.indices), count);
+  }
+
+  // A cache that is always valid and its vertices quantized for upload.
+  struct Prepared {
+    MeshCache cache;
+    std::vector<int16_t> positions;
+    std::vector<uint8_t> colors;
+    std::vector<int16_t> normals;
+    quantize::Error positionError;
+    quantize::Error colorError;
+    quantize::Error normalError;
+
+    explicit Prepared(MeshCache&& loaded) : cache(std::move(loaded)) {
+      size_t n = cache.header->vertexCount;
+      quantize::Bounds bounds = layoutOf(cache).bounds;
+      positions.resize(n * 4);
+      colors.resize(n * 4);
+      normals.resize(n * 2);
+      quantize::encodePositions({ cache.positions, 3 }, n, bounds, { positions.data(), 4 });
+      quantize::encodeColors({ cache.colors, 3 }, n, { colors.data(), 4 });
+      quantize::encodeNormals({ cache.normals, 3 }, n, { normals.data(), 2 });
+      positionError = quantize::positionError({ cache.positions, 3 }, { positions.data(), 4 }, n, bounds);
+      colorError = quantize::colorError({ cache.colors, 3 }, { colors.data(), 4 }, n);
+      normalError = quantize::normalError({ cache.normals, 3 }, { normals.data(), 2 }, n);
+    }
+  };
+
+  // Loads or parses the cache and quantizes its vertices, on a worker thread
+  // ahead of constructing the geometry from it.
+  static Prepared prepare(const std::string& path, bool split16 = false) {
+    MeshCache cache(path);
+    return Prepared(matches(cache, split16) ? std::move(cache) : parse(path, split16));
+  }
+
+  static Layout layoutOf(const MeshCache& cache) {
+    return {
+      cache.header->vertexCount, cache.header->indexCount, cache.header->indexSize,
+      quantize::Bounds::fromBox(cache.header->boundsMin, cache.header->boundsMax)
+    };
+  }
+
+  // the clusters of a split mesh, or the full level of a mesh with levels of detail
+  static std::vector<WGPU::IndexRange> ranges(const MeshCache& cache) {
+    std::vector<WGPU::IndexRange> out;
+    if (cache.header->lodCount) out.push_back({ cache.lods[0].firstIndex, cache.lods[0].indexCount, 0 });
+    for (size_t i = 0; i < cache.header->clusterCount; i++) {
+      auto& c = cache.clusters[i];
+      out.push_back({ c.firstIndex, c.indexCount, c.baseVertex });
+    }
+    return out;
+  }
+
+  // uploads what prepare() quantized
+  MeshGeometry(WGPU::Context& ctx, const std::vector<WGPUBindGroupLayout>& bindGroupLayouts,
+    Prepared&& loaded) :
+    cache(std::move(loaded.cache)),
+    layout(layoutOf(cache)),
+    shaderSource(quantize::wgsl(layout.bounds) + shaderBody),
+    positionError(loaded.positionError),
+    colorError(loaded.colorError),
+    normalError(loaded.normalError),
     vertexBuffer0(ctx, {
       .label = "vertex",
-      .size = vertices.size() * sizeof(float),
+      .size = layout.vertexCount * 4 * sizeof(int16_t),
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
       .mappedAtCreation = false
       }),
     vertexBuffer1(ctx, {
       .label = "vertex",
-      .size = vertices.size() * sizeof(float),
+      .size = layout.vertexCount * 4 * sizeof(uint8_t),
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+      .mappedAtCreation = false
+      }),
+    vertexBuffer2(ctx, {
+      .label = "vertex",
+      .size = layout.vertexCount * 2 * sizeof(int16_t),
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
       .mappedAtCreation = false
       }),
     indexBuffer(ctx, {
       .label = "index",
-      .size = (indices.size() * sizeof(uint16_t) + 3) & ~3, // round up to the next multiple of 4
+      .size = (layout.indexCount * layout.indexSize + 3) & ~3, // round up to the next multiple of 4
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
       .mappedAtCreation = false
       }),
@@ -193,26 +382,36 @@ public:
         {
           .buffer = vertexBuffer0,
           .attributes = {
-            {.shaderLocation = 0, .format = WGPUVertexFormat_Float32x3, .offset = 0 },
+            {.shaderLocation = 0, .format = WGPUVertexFormat_Snorm16x4, .offset = 0 },
           },
-          .arrayStride = 3 * sizeof(float),
+          .arrayStride = 4 * sizeof(int16_t),
           .stepMode = WGPUVertexStepMode_Vertex
         },
         {
           .buffer = vertexBuffer1,
           .attributes = {
-            {.shaderLocation = 1, .format = WGPUVertexFormat_Float32x3, .offset = 0 },
+            {.shaderLocation = 1, .format = WGPUVertexFormat_Unorm8x4, .offset = 0 },
+          },
+          .arrayStride = 4 * sizeof(uint8_t),
+          .stepMode = WGPUVertexStepMode_Vertex
+        },
+        {
+          .buffer = vertexBuffer2,
+          .attributes = {
+            {.shaderLocation = 2, .format = WGPUVertexFormat_Snorm16x2, .offset = 0 },
           },
-          .arrayStride = 3 * sizeof(float),
+          .arrayStride = 2 * sizeof(int16_t),
           .stepMode = WGPUVertexStepMode_Vertex
         }
       },
       .indexBuffer = indexBuffer,
-      .count = static_cast<uint32_t>(indices.size()),
+      .count = static_cast<uint32_t>(layout.indexCount),
+      .indexFormat = layout.indexSize == 2 ? WGPUIndexFormat_Uint16 : WGPUIndexFormat_Uint32,
+      .ranges = ranges(cache),
       },
     pipeline(ctx, {
-      .source = shaderSource,
-      .bindGroups = bindGroups,
+      .source = shaderSource.c_str(),
+      .bindGroupLayouts = bindGroupLayouts,
       .vertex = {
         .entryPoint = "vs",
         .buffers = geom.vertexBuffers,
@@ -247,20 +446,62 @@ public:
       }
     )
   {
-    readOFF("../../data/screwdriver.off", vertices, indices);
+    vertexBuffer0.write(loaded.positions.data());
+    vertexBuffer1.write(loaded.colors.data());
+    vertexBuffer2.write(loaded.normals.data());
+    geom.indexBuffer.write(cache.indices);
+
+    SDL_Log("mesh: %llu vertices in %llu bytes instead of %llu, position error max %g rms %g, color error max %g, normal error max %g",
+      (unsigned long long)layout.vertexCount,
+      (unsigned long long)(vertexBuffer0.size + vertexBuffer1.size + vertexBuffer2.size),
+      (unsigned long long)(layout.vertexCount * 9 * sizeof(float)),
+      positionError.max, positionError.rms, colorError.max, normalError.max);
+  }
+
+  size_t lodCount() const { return std::max<size_t>(cache.header->lodCount, 1); }
+  size_t lodLevel() const { return lod; }
+  size_t meshletCount() const { return levelMeshlets; }
+  size_t visibleMeshletCount() const { return visibleMeshlets; }
 
-    Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> mat(vertices.data(), 3395, 3);
-    mat = (mat.rowwise() - mat.colwise().mean()) / mat.maxCoeff();
-    geom.vertexBuffers[0].buffer.write(vertices.data());
+  size_t triangleCount() const {
+    if (geom.ranges.empty()) return levelMeshlets ? 0 : layout.indexCount / 3;
+    size_t n = 0;
+    for (auto& range : geom.ranges) n += range.count / 3;
+    return n;
+  }
 
-    auto colors = (mat.rowwise() - mat.colwise().minCoeff()).array().rowwise() /
-      (mat.colwise().maxCoeff() - mat.colwise().minCoeff()).array();
-    geom.vertexBuffers[1].buffer.write(colors.eval().data());
+  // Draws the coarsest level of detail that stays within threshold pixels
+  // of the full mesh, from the projected size of the bounds under model.
+  void selectLod(const Camera& camera, const Eigen::Matrix4f& model, float height, float threshold = 1) {
+    if (!cache.header->lodCount) return;
+    levelMeshlets = 0;
+    const quantize::Bounds& b = layout.bounds;
+    Eigen::Vector3f center = (model * Eigen::Vector4f(b.center[0], b.center[1], b.center[2], 1)).head<3>();
+    float radius = Eigen::Vector3f(b.scale[0], b.scale[1], b.scale[2]).norm();
+    float pixels = projectedRadius(camera, center, radius, height);
+    lod = mesh::selectLod(cache.lods, cache.header->lodCount, pixels / radius, threshold);
+    geom.ranges = { { cache.lods[lod].firstIndex, cache.lods[lod].indexCount, 0 } };
+  }
 
-    geom.indexBuffer.write(indices.data());
+  // Draws only the meshlets of the selected level that intersect the
+  // frustum of clip and face eye, both in model space.
+  void cull(const Eigen::Matrix4f& clip, const Eigen::Vector3f& eye) {
+    if (!cache.header->meshletCount) return;
+    const mesh::Lod& level = cache.lods[lod];
+    const mesh::Meshlet* begin = cache.meshlets, * end = begin + cache.header->meshletCount;
+    auto before = [](const mesh::Meshlet& m, uint32_t index) { return m.firstIndex < index; };
+    const mesh::Meshlet* first = std::lower_bound(begin, end, level.firstIndex, before);
+    const mesh::Meshlet* last = std::lower_bound(first, end, level.firstIndex + level.indexCount, before);
+
+    geom.ranges.clear();
+    levelMeshlets = last - first;
+    visibleMeshlets = mesh::cullMeshlets(first, levelMeshlets, mesh::Frustum::fromMatrix(clip), eye,
+      [&](uint32_t firstIndex, uint32_t indexCount) { geom.ranges.push_back({ firstIndex, indexCount, 0 }); });
   }
 
   void draw(WGPU::RenderPass& pass) {
+    // empty ranges would draw everything
+    if (levelMeshlets && geom.ranges.empty()) return;
     pass.setPipeline(pipeline);
     pass.draw(geom);
   }
@@ -269,10 +510,24 @@ public:
 class Application : public WGPUApplication {
 public:
   WGPU::Buffer uCamera;
-  WGPU::Buffer uModel;
-
+  // the model matrices of a frame, bound with dynamic offsets
+  WGPU::UniformArena models;
+  // shared by the pipelines of the gnomon and the mesh
+  WGPU::BindGroup cameraGroup;
+  // the uniforms of every frame
+  WGPU::Uploader uploads{ ctx, 64 << 10 };
+
+  // the mesh is loaded in the background and drawn once it is ready
+  task::Task loading;
   GnomonGeometry gnomon;
-  MeshGeometry mesh;
+  std::optional<MeshGeometry> mesh;
+  // triangles of the mesh in model space, for picking the orbit target
+  mesh::Bvh bvh;
+
+  // declared after everything the loading coroutine touches, so the workers
+  // are stopped first on destruction
+  task::Queue frames;
+  task::Pool workers{ 1 };
 
   WGPUTexture depthTexture;
 
@@ -293,8 +548,16 @@ public:
 
   struct {
     bool isDown = false;
+    // screen-space error of the level of detail
+    float lodThreshold = 1;
+    bool cull = true;
+    // the camera orbits around the last picked point
+    Eigen::Vector3f target = { 0, 0, 0 };
+    double pickTime = 0;
 
     Eigen::Vector3f dir = { 0, M_PI_2,1 };
+    // of the last frame
+    WGPU::RenderPass::Counters passCounters;
   } state;
 
   Application() : WGPUApplication(1280, 720),
@@ -304,70 +567,33 @@ public:
       .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
       .mappedAtCreation = false,
       }),
-      uModel(ctx, {
-        .label = "model",
-        .size = sizeof(float) * 16,
-        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-        .mappedAtCreation = false,
-        }),
-        gnomon(ctx, {
-            {
-              .label = "camera",
-              .entries = {
-                {
-                  .binding = 0,
-                  .buffer = &uCamera,
-                  .offset = 0,
-                  .visibility = WGPUShaderStage_Vertex,
-                  .layout = {
-                    .type = WGPUBufferBindingType_Uniform,
-                    .hasDynamicOffset = false,
-                    .minBindingSize = uCamera.size,
-                    }
-                },
-                {
-                  .binding = 1,
-                  .buffer = &uModel,
-                  .offset = 0,
-                  .visibility = WGPUShaderStage_Vertex,
-                  .layout = {
-                    .type = WGPUBufferBindingType_Uniform,
-                    .hasDynamicOffset = false,
-                    .minBindingSize = uModel.size,
-                  }
-                }
-              }
-            }
-          }),
-    mesh(ctx, {
+      models(ctx, 64 << 10, "models"),
+    cameraGroup(ctx, "camera", {
       {
-        .label = "camera",
-        .entries = {
-          {
-            .binding = 0,
-            .buffer = &uCamera,
-            .offset = 0,
-            .visibility = WGPUShaderStage_Vertex,
-            .layout = {
-              .type = WGPUBufferBindingType_Uniform,
-              .hasDynamicOffset = false,
-              .minBindingSize = uCamera.size,
-              }
-          },
-          {
-            .binding = 1,
-            .buffer = &uModel,
-            .offset = 0,
-            .visibility = WGPUShaderStage_Vertex,
-            .layout = {
-              .type = WGPUBufferBindingType_Uniform,
-              .hasDynamicOffset = false,
-              .minBindingSize = uModel.size,
-            }
+        .binding = 0,
+        .buffer = &uCamera,
+        .offset = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .layout = {
+          .type = WGPUBufferBindingType_Uniform,
+          .hasDynamicOffset = false,
+          .minBindingSize = uCamera.size,
           }
+      },
+      {
+        .binding = 1,
+        .buffer = &models.buffer,
+        .offset = 0,
+        .size = sizeof(float) * 16,
+        .visibility = WGPUShaderStage_Vertex,
+        .layout = {
+          .type = WGPUBufferBindingType_Uniform,
+          .hasDynamicOffset = true,
+          .minBindingSize = sizeof(float) * 16,
         }
       }
       }),
+    gnomon(ctx, { cameraGroup.layout }),
     orbit(camera.object)
   {
     WGPUTextureFormat depthTextureFormat = WGPUTextureFormat_Depth24Plus;
@@ -382,6 +608,22 @@ public:
       .viewFormats = &depthTextureFormat,
     };
     depthTexture = wgpuDeviceCreateTexture(ctx.device, &depthTextureDesc);
+
+    loading = load("../../data/screwdriver.off");
+  }
+
+  // Reads and preprocesses the mesh on a worker, then creates and uploads
+  // the GPU buffers between two frames on the render thread.
+  task::Task load(std::string path) {
+    co_await workers.schedule();
+    MeshGeometry::Prepared prepared = MeshGeometry::prepare(path);
+    mesh::Bvh triangles;
+    MeshGeometry::withIndices(prepared.cache, [&](const auto* indices, size_t count) {
+      triangles = mesh::Bvh(indices, count, prepared.cache.positions);
+      });
+    co_await frames.schedule();
+    mesh.emplace(ctx, std::vector{ cameraGroup.layout }, std::move(prepared));
+    bvh = std::move(triangles);
   }
 
   ~Application() {
@@ -389,12 +631,26 @@ public:
     wgpuTextureRelease(depthTexture);
   }
 
+  // Moves the orbit target to the mesh surface under ndc, if there is one.
+  void pick(const Eigen::Matrix4f& clip, const Eigen::Matrix4f& model, const Eigen::Vector2f& ndc) {
+    if (!bvh) return;
+    auto t0 = std::chrono::steady_clock::now();
+    mesh::Ray ray = mesh::Ray::unproject(clip, ndc);
+    mesh::RayHit hit = bvh.intersect(ray);
+    state.pickTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (hit) state.target = (model * ray.at(hit.t).homogeneous()).head<3>();
+  }
+
   void render() {
+    frames.run();
+    loading.rethrow();
+
     Eigen::Vector3f vec;
     Eigen::Quaternionf rot;
     Eigen::Matrix4f m;
     math::rotation(m, math::betweenZ(rot, math::sph2cart(vec, state.dir)));
-    uModel.write(m.data());
+    uint32_t model = models.push(m);
+    models.upload(uploads);
 
     CameraUniform uniformData{};
     math::perspective(Eigen::Map<Eigen::Matrix4f>(uniformData.proj.data()),
@@ -402,7 +658,16 @@ public:
       camera.perspective.near, camera.perspective.far);
 
     lookAt(Eigen::Map<Eigen::Matrix4f>(uniformData.view.data()), camera.object);
-    uCamera.write(&uniformData);
+    uploads.write(uCamera, 0, &uniformData, sizeof(uniformData));
+
+    Eigen::Matrix4f clip = Eigen::Map<Eigen::Matrix4f>(uniformData.proj.data()) * Eigen::Map<Eigen::Matrix4f>(uniformData.view.data()) * m;
+    if (mesh) {
+      mesh->selectLod(camera, m, float(std::get<1>(ctx.size)), state.lodThreshold);
+      if (state.cull) {
+        Eigen::Vector3f eye = (m.inverse() * camera.object.position.homogeneous()).head<3>();
+        mesh->cull(clip, eye);
+      }
+    }
 
     WGPUTextureView view = ctx.surfaceTextureCreateView();
     std::vector<WGPUCommandBuffer> commands;
@@ -447,9 +712,11 @@ public:
         .depthStencilAttachment = &depthStencilAttachment,
       };
       WGPU::RenderPass pass = encoder.renderPass(&passDescriptor);
+      pass.setBindGroup(0, cameraGroup, model);
       gnomon.draw(pass);
-      mesh.draw(pass);
+      if (mesh) mesh->draw(pass);
       pass.end();
+      state.passCounters = pass.counters;
 
       WGPUCommandBufferDescriptor commandDescriptor{};
       commands.push_back(encoder.finish(&commandDescriptor));
@@ -467,10 +734,12 @@ public:
       mouse *= 2.;
       mouse.array() -= 1.;
       mouse.x() *= ctx.aspect;
-      if (state.isDown != ImGui::IsMouseDown(0) && !state.isDown)
+      if (state.isDown != ImGui::IsMouseDown(0) && !state.isDown) {
+        pick(clip, m, Eigen::Vector2f(2 * io.MousePos.x / std::get<0>(ctx.size) - 1, 1 - 2 * io.MousePos.y / std::get<1>(ctx.size)));
         orbit.begin(mouse);
+      }
       if ((state.isDown = ImGui::IsMouseDown(0)))
-        orbit.end(mouse, Eigen::Vector3f(0, 0, 0));
+        orbit.end(mouse, state.target);
     }
 
     {
@@ -479,6 +748,15 @@ public:
       ImGui::Begin("Controls");
       ImGui::SliderFloat("phi", &state.dir.x(), 0.0f, M_PI * 2.);
       ImGui::SliderFloat("theta", &state.dir.y(), -M_PI_2, M_PI_2);
+      ImGui::SliderFloat("lod error (px)", &state.lodThreshold, 0.f, 8.f);
+      ImGui::Checkbox("cull meshlets", &state.cull);
+      if (mesh) ImGui::Text("lod %zu/%zu, %zu triangles", mesh->lodLevel(), mesh->lodCount(), mesh->triangleCount());
+      if (mesh && mesh->meshletCount())
+        ImGui::Text("meshlets %zu/%zu", mesh->visibleMeshletCount(), mesh->meshletCount());
+      if (bvh) ImGui::Text("pick %.3f ms", state.pickTime * 1e3);
+      ImGui_passStats(state.passCounters);
+      ImGui_uploadStats(uploads);
+      ImGui_cacheStats(ctx);
 
       ImGui::End();
     }
@@ -487,6 +765,7 @@ public:
     commands.push_back(ImGui_command(ctx, view));
     wgpuTextureViewRelease(view);
 
+    uploads.flush();
     ctx.submitCommands(commands);
     ctx.releaseCommands(commands);
 
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include "generate.hpp"
+#include "mesh.hpp"
+#include "mesh_bvh.hpp"
+#include "read_off.hpp"
+
+double seconds(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Builds the hierarchy on 1 thread and on all cores, then casts rays from a
+// circle around the mesh at points spread over it, like picks.
+void run(const std::string& name, std::vector<float>& V, const std::vector<uint32_t>& F, size_t rays) {
+  size_t vertexCount = V.size() / 3;
+  mesh::normalize(V.data(), vertexCount);
+
+  mesh::Bvh bvh;
+  for (unsigned threads : { 1u, parallel::threadCount() }) {
+    auto t0 = std::chrono::steady_clock::now();
+    bvh = mesh::Bvh(F.data(), F.size(), V.data(), threads);
+    printf("%s,%zu,build,%u,%zu,%.9f\n", name.c_str(), F.size() / 3, threads, bvh.nodes.size(), seconds(t0));
+    fflush(stdout);
+    if (threads == parallel::threadCount()) break;
+  }
+
+  bench::Random random{ 1 };
+  size_t hits = 0;
+  double worst = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rays; i++) {
+    float a = float(M_PI * random.uniform());
+    Eigen::Vector3f origin(3 * std::cos(a), .5f * float(random.uniform()), 3 * std::sin(a));
+    Eigen::Vector3f target = Eigen::Vector3f(float(random.uniform()), float(random.uniform()), float(random.uniform())) * .5f;
+    auto t1 = std::chrono::steady_clock::now();
+    hits += bool(bvh.intersect({ origin, target - origin }));
+    worst = std::max(worst, seconds(t1));
+  }
+  double t = seconds(t0);
+  printf("%s,%zu,intersect,1,%zu,%.9f\n", name.c_str(), F.size() / 3, hits, t / rays);
+  printf("%s,%zu,intersect worst,1,%zu,%.9f\n", name.c_str(), F.size() / 3, hits, worst);
+  fflush(stdout);
+}
+
+// Prints CSV build times and per ray query times, where count is the node
+// count for builds and the hit count for queries:
+//
+//   bench_bvh [mesh.off ...]
+//
+// Without arguments it runs on generated grids and spheres of 100K, 1M and
+// 10M faces.
+int main(int argc, char** argv) {
+  printf("mesh,faces,case,threads,count,seconds\n");
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  for (int i = 1; i < argc; i++) {
+    if (!readOFFParallel(argv[i], V, F)) return 1;
+    run(std::filesystem::path(argv[i]).filename().string(), V, F, 10000);
+  }
+  if (argc > 1) return 0;
+
+  std::string path = (std::filesystem::temp_directory_path() / "bench_bvh.off").string();
+  for (const char* shape : { "grid", "sphere" })
+    for (size_t faces : { 100000, 1000000, 10000000 }) {
+      if (std::strcmp(shape, "sphere") == 0) bench::writeSphere(path, faces);
+      else bench::writeGrid(path, faces);
+      if (!readOFFParallel(path, V, F)) return 1;
+      std::filesystem::remove(path);
+      run(shape, V, F, 10000);
+    }
+}
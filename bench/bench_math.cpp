@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "generate.hpp"
+#include "math.hpp"
+
+double seconds(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template <typename Fn>
+double best(int runs, Fn fn) {
+  double t = INFINITY;
+  for (int i = 0; i < runs; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    t = std::min(t, seconds(t0));
+  }
+  return t;
+}
+
+// Builds model and model-view-projection matrices of random poses with the
+// scalar functions, one instance at a time, and with the batch kernels.
+void run(size_t count, int runs) {
+  bench::Random random{ 1 };
+  std::vector<float> x(count), y(count), z(count), qx(count), qy(count), qz(count), qw(count);
+  for (size_t i = 0; i < count; i++) {
+    Eigen::Quaternionf q(float(random.uniform()), float(random.uniform()), float(random.uniform()), float(random.uniform()));
+    q.normalize();
+    qx[i] = q.x(); qy[i] = q.y(); qz[i] = q.z(); qw[i] = q.w();
+    x[i] = float(random.uniform()); y[i] = float(random.uniform()); z[i] = float(random.uniform());
+  }
+  math::Poses poses{ x.data(), y.data(), z.data(), qx.data(), qy.data(), qz.data(), qw.data() };
+  Eigen::Matrix4f proj = Eigen::Matrix4f::Zero(), view;
+  math::perspective(proj, math::radians(45), 1.5f, .1f, 100);
+  math::lookAt(view, Eigen::Vector3f(0, 0, 5), -Eigen::Vector3f::UnitZ(), Eigen::Vector3f::UnitY());
+  Eigen::Matrix4f viewProjection = proj * view;
+  std::vector<float> out(count * 16);
+
+  auto scalar = [&](bool mvp) {
+    for (size_t i = 0; i < count; i++) {
+      Eigen::Map<Eigen::Matrix4f> m(&out[i * 16]);
+      math::rotation(m, Eigen::Quaternionf(qw[i], qx[i], qy[i], qz[i]));
+      m.col(3).head<3>() << x[i], y[i], z[i];
+      if (mvp) m = viewProjection * m;
+    }
+  };
+  auto print = [&](const char* name, double t) {
+    printf("%zu,%s,%.9f,%.0f\n", count, name, t, count / t);
+    fflush(stdout);
+  };
+  print("model scalar", best(runs, [&] { scalar(false); }));
+  print("model batch", best(runs, [&] { math::models(poses, count, out.data()); }));
+  print("mvp scalar", best(runs, [&] { scalar(true); }));
+  print("mvp batch", best(runs, [&] { math::modelViewProjections(viewProjection, poses, count, out.data()); }));
+}
+
+// Prints CSV times and instances/s of the instance transform kernels:
+//
+//   bench_math [--runs N] [count ...]
+//
+// Without counts it runs 1K, 10K, 100K and 1M instances.
+int main(int argc, char** argv) {
+  int runs = 20;
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--runs" && i + 1 < argc) runs = std::atoi(argv[++i]);
+    else counts.push_back(std::strtoull(argv[i], nullptr, 10));
+  }
+  if (counts.empty()) counts = { 1000, 10000, 100000, 1000000 };
+  printf("instances,case,seconds,instances/s\n");
+  for (size_t count : counts) run(count, runs);
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include "generate.hpp"
+#include "mesh.hpp"
+#include "mesh_optimize.hpp"
+#include "read_off.hpp"
+
+double seconds(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void run(const std::string& name, const std::vector<float>& V, std::vector<uint32_t> F) {
+  size_t vertexCount = V.size() / 3;
+  auto print = [&](const char* stage, const std::vector<uint32_t>& indices, double t) {
+    auto stats = mesh::analyzeCache(indices.data(), indices.size(), vertexCount);
+    printf("%s,%zu,%zu,%s,%.4f,%.4f,%.9f\n", name.c_str(), F.size() / 3, vertexCount, stage, stats.acmr, stats.atvr, t);
+    fflush(stdout);
+  };
+  print("input", F, 0);
+
+  std::vector<uint32_t> ordered(F.size());
+  auto t0 = std::chrono::steady_clock::now();
+  auto clusters = mesh::optimizeCache(F.data(), F.size(), vertexCount, ordered.data());
+  print("optimizeCache", ordered, seconds(t0));
+
+  t0 = std::chrono::steady_clock::now();
+  mesh::optimizeOverdraw(ordered.data(), ordered.size(), V.data(), vertexCount, clusters, F.data());
+  print("optimizeOverdraw", F, seconds(t0));
+
+  std::vector<uint32_t> remap;
+  t0 = std::chrono::steady_clock::now();
+  mesh::optimizeVertexFetch(F.data(), F.size(), vertexCount, remap);
+  print("optimizeVertexFetch", F, seconds(t0));
+}
+
+// Prints CSV cache statistics (ACMR, ATVR) and timings of every optimization
+// stage, one row per mesh and stage:
+//
+//   bench_optimize [mesh.off ...]
+//
+// Without arguments it runs on generated grids and spheres of 100K and 1M
+// faces whose triangles are shuffled like a scan.
+int main(int argc, char** argv) {
+  printf("mesh,faces,vertices,stage,acmr,atvr,seconds\n");
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  for (int i = 1; i < argc; i++) {
+    if (!readOFFParallel(argv[i], V, F)) return 1;
+    run(std::filesystem::path(argv[i]).filename().string(), V, F);
+  }
+  if (argc > 1) return 0;
+
+  std::string path = (std::filesystem::temp_directory_path() / "bench_optimize.off").string();
+  for (const char* shape : { "grid", "sphere" })
+    for (size_t faces : { 100000, 1000000 }) {
+      if (std::strcmp(shape, "sphere") == 0) bench::writeSphere(path, faces);
+      else bench::writeGrid(path, faces);
+      if (!readOFFParallel(path, V, F)) return 1;
+      std::filesystem::remove(path);
+
+      bench::Random random{ faces };
+      for (size_t t = F.size() / 3; t > 1; t--) {
+        size_t u = random.next() % t;
+        std::swap_ranges(F.begin() + (t - 1) * 3, F.begin() + t * 3, F.begin() + u * 3);
+      }
+      run(std::string(shape) + "/shuffled", V, F);
+    }
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include "generate.hpp"
+#include "mesh.hpp"
+#include "mesh_pipeline.hpp"
+#include "read_off.hpp"
+#include "read_ply.hpp"
+
+// Best wall time of `runs` calls, with reset() run untimed before each call.
+double best(int runs, const std::function<void()>& fn, const std::function<void()>& reset = [] {}) {
+  double t = INFINITY;
+  for (int i = 0; i < runs; i++) {
+    reset();
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    t = std::min(t, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+  }
+  return t;
+}
+
+struct Row {
+  const char* shape;
+  bench::MeshInfo info;
+  int runs;
+
+  // one CSV line, `bytes` is what the case reads
+  void print(const std::string& name, unsigned threads, double bytes, double t) const {
+    printf("%s,%zu,%zu,%s,%u,%d,%.9f,%.3f,%.0f\n",
+      shape, info.faces, info.vertices, name.c_str(), threads, runs, t, bytes / t / 1e6, info.faces / t);
+    fflush(stdout);
+  }
+};
+
+void run(const char* shape, size_t faces, int runs) {
+  std::string path = (std::filesystem::temp_directory_path() / "bench_read_off.off").string();
+  bench::MeshInfo info = std::strcmp(shape, "sphere") == 0 ?
+    bench::writeSphere(path, faces) : bench::writeGrid(path, faces);
+  double bytes = std::filesystem::file_size(path);
+  fprintf(stderr, "%s: %s, %.1f MB, %zu vertices, %zu faces\n", shape, path.c_str(), bytes / 1e6, info.vertices, info.faces);
+  Row row{ shape, info, runs };
+
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  row.print("readOFF", 1, bytes, best(runs, [&] { readOFF(path, V, F); }));
+  row.print("readOFFMapped", 1, bytes, best(runs, [&] { readOFFMapped(path, V, F); }));
+  for (unsigned threads = 1;; threads = std::min(threads * 2, parallel::threadCount())) {
+    row.print("readOFFParallel", threads, bytes, best(runs, [&] { readOFFParallel(path, V, F, threads); }));
+    if (threads == parallel::threadCount()) break;
+  }
+  std::filesystem::remove(path);
+
+  // the same mesh as binary PLY, with the throughput of the smaller file
+  bench::writePLY(path, V, F);
+  std::vector<float> V1;
+  std::vector<uint32_t> F1;
+  row.print("readPLY", 1, std::filesystem::file_size(path), best(runs, [&] { readPLY(path, V1, F1); }));
+  std::filesystem::remove(path);
+
+  // the preprocessing MeshGeometry runs after loading, in memory and batched
+  size_t count = V.size() / 3;
+  double positions = double(V.size()) * sizeof(float);
+  std::vector<float> work(V.size()), colors(V.size());
+  auto reset = [&] { std::copy(V.begin(), V.end(), work.begin()); };
+  row.print("normalize+colorFromBounds", 1, positions, best(runs, [&] {
+    mesh::normalize(work.data(), count);
+    mesh::colorFromBounds(work.data(), count, colors.data());
+    }, reset));
+  mesh::Pipeline fused;
+  fused.then(mesh::passes::normalize()).then(mesh::passes::colorFromBounds());
+  mesh::MeshData data;
+  for (unsigned threads = 1;; threads = std::min(threads * 2, parallel::threadCount())) {
+    row.print("pipeline normalize+colorFromBounds", threads, positions, best(runs, [&] { fused.run(data, threads); },
+      [&] { data.positions = V; }));
+    if (threads == parallel::threadCount()) break;
+  }
+  row.print("normalizeBatch", 1, positions, best(runs, [&] {
+    size_t batch = 1 << 18;
+    mesh::Stats stats;
+    for (size_t i = 0; i < count; i += batch)
+      stats.add(work.data() + i * 3, std::min(batch, count - i));
+    for (size_t i = 0; i < count; i += batch)
+      mesh::normalizeBatch(stats, work.data() + i * 3, std::min(batch, count - i), colors.data() + i * 3);
+    }, reset));
+}
+
+// Prints CSV timings to stdout, one row per shape, size and case:
+//
+//   bench_read_off [--runs N] [--shape grid|sphere|all] [faces ...]
+//
+// Sizes default to 10K, 100K, 1M and 10M faces.
+int main(int argc, char** argv) {
+  int runs = 3;
+  std::string shape = "all";
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--runs" && i + 1 < argc) runs = std::max(1, std::stoi(argv[++i]));
+    else if (arg == "--shape" && i + 1 < argc) shape = argv[++i];
+    else sizes.push_back(std::stoull(arg));
+  }
+  if (sizes.empty()) sizes = { 10000, 100000, 1000000, 10000000 };
+
+  printf("shape,faces,vertices,case,threads,runs,seconds,mb_per_s,faces_per_s\n");
+  for (const char* s : { "grid", "sphere" })
+    if (shape == "all" || shape == s)
+      for (size_t faces : sizes) run(s, faces, runs);
+}
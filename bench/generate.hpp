@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Deterministic OFF meshes for the benchmarks. The noise comes from a fixed
+// seed splitmix64 rather than <random>, whose distributions differ between
+// standard libraries, so every platform writes byte-identical files.
+namespace bench {
+  struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+      uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    // uniform in [-1, 1)
+    double uniform() { return double(next() >> 11) * 0x1p-52 - 1.; }
+  };
+
+  struct MeshInfo {
+    size_t vertices;
+    size_t faces;
+  };
+
+  // An n x n vertex grid with a bit of height noise, two triangles per cell,
+  // sized to roughly `faces` triangles.
+  inline MeshInfo writeGrid(const std::string& path, size_t faces, uint64_t seed = 1) {
+    size_t n = std::max<size_t>(2, size_t(std::sqrt(faces / 2.)) + 1);
+    MeshInfo info{ n * n, 2 * (n - 1) * (n - 1) };
+    Random random{ seed };
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return { 0, 0 };
+    fprintf(file, "OFF\n%zu %zu 0\n", info.vertices, info.faces);
+    for (size_t j = 0; j < n; j++)
+      for (size_t i = 0; i < n; i++)
+        fprintf(file, "%.6f %.6f %.6f\n", double(i) / n, double(j) / n, 0.01 * random.uniform());
+    for (size_t j = 0; j + 1 < n; j++)
+      for (size_t i = 0; i + 1 < n; i++) {
+        size_t a = j * n + i, b = a + 1, c = a + n, d = c + 1;
+        fprintf(file, "3 %zu %zu %zu\n3 %zu %zu %zu\n", a, b, d, a, d, c);
+      }
+    fclose(file);
+    return info;
+  }
+
+  // A UV sphere with the radius perturbed by up to 5% per vertex, sized to
+  // roughly `faces` triangles. The poles are single vertices with triangle fans.
+  inline MeshInfo writeSphere(const std::string& path, size_t faces, uint64_t seed = 1) {
+    size_t rings = std::max<size_t>(3, size_t(std::sqrt(faces / 4.)));
+    size_t segments = std::max<size_t>(3, 2 * rings);
+    MeshInfo info{ (rings - 1) * segments + 2, 2 * segments * (rings - 1) };
+    Random random{ seed };
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return { 0, 0 };
+    fprintf(file, "OFF\n%zu %zu 0\n", info.vertices, info.faces);
+    auto vertex = [&](double theta, double phi) {
+      double r = 1. + 0.05 * random.uniform();
+      fprintf(file, "%.6f %.6f %.6f\n",
+        r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi));
+    };
+    vertex(0, 0);
+    for (size_t j = 1; j < rings; j++)
+      for (size_t i = 0; i < segments; i++)
+        vertex(M_PI * j / rings, 2 * M_PI * i / segments);
+    vertex(M_PI, 0);
+
+    size_t south = info.vertices - 1;
+    auto ring = [&](size_t j, size_t i) { return 1 + (j - 1) * segments + i % segments; };
+    for (size_t i = 0; i < segments; i++)
+      fprintf(file, "3 0 %zu %zu\n", ring(1, i + 1), ring(1, i));
+    for (size_t j = 1; j + 1 < rings; j++)
+      for (size_t i = 0; i < segments; i++) {
+        size_t a = ring(j, i), b = ring(j, i + 1), c = ring(j + 1, i), d = ring(j + 1, i + 1);
+        fprintf(file, "3 %zu %zu %zu\n3 %zu %zu %zu\n", a, b, d, a, d, c);
+      }
+    for (size_t i = 0; i < segments; i++)
+      fprintf(file, "3 %zu %zu %zu\n", south, ring(rings - 1, i), ring(rings - 1, i + 1));
+    fclose(file);
+    return info;
+  }
+
+  // The same mesh as binary little endian PLY, x y z floats and triangle lists.
+  inline bool writePLY(const std::string& path, const std::vector<float>& V, const std::vector<uint32_t>& F) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fprintf(file, "ply\nformat binary_little_endian 1.0\n"
+      "element vertex %zu\nproperty float x\nproperty float y\nproperty float z\n"
+      "element face %zu\nproperty list uchar uint vertex_indices\nend_header\n", V.size() / 3, F.size() / 3);
+    fwrite(V.data(), sizeof(float), V.size(), file);
+    for (size_t i = 0; i + 3 <= F.size(); i += 3) {
+      uint8_t n = 3;
+      fwrite(&n, 1, 1, file);
+      fwrite(&F[i], sizeof(uint32_t), 3, file);
+    }
+    return fclose(file) == 0;
+  }
+}
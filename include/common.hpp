@@ -46,6 +46,15 @@ struct Camera {
   Perspective perspective;
 };
 
+// Radius in pixels of a sphere seen by the camera, for a viewport of the
+// given height. Infinite once the camera is inside the sphere.
+inline float projectedRadius(const Camera& camera, const Eigen::Vector3f& center, float radius, float height) {
+  float distance = (center - camera.object.position).norm();
+  if (distance <= radius) return INFINITY;
+  float tangent = std::sqrt(distance * distance - radius * radius);
+  return radius / (tangent * std::tan(camera.perspective.fov * .5f)) * height * .5f;
+}
+
 class ArcBall {
 public:
   Eigen::Vector3f p0;
@@ -40,4 +40,24 @@ WGPUCommandBuffer ImGui_command(WGPU::Context& ctx, WGPUTextureView view) {
 
   WGPUCommandBufferDescriptor commandDescriptor{};
   return encoder.finish(&commandDescriptor);
-};
\ No newline at end of file
+};
+// hit and miss counters of the caches of ctx
+void ImGui_cacheStats(const WGPU::Context& ctx) {
+  auto& cache = ctx.pipelineCache;
+  ImGui::Text("pipelines %llu hit, %llu miss", (unsigned long long)cache.renderPipelines.hits,
+    (unsigned long long)cache.renderPipelines.misses);
+  ImGui::Text("shaders %llu hit, %llu miss", (unsigned long long)cache.shaderModules.hits,
+    (unsigned long long)cache.shaderModules.misses);
+  ImGui::Text("layouts %llu hit, %llu miss", (unsigned long long)cache.bindGroupLayouts.hits,
+    (unsigned long long)cache.bindGroupLayouts.misses);
+}
+// what uploads staged in its last frame
+void ImGui_uploadStats(const WGPU::Uploader& uploads) {
+  ImGui::Text("uploads %llu bytes, %llu writes in %llu copies", (unsigned long long)uploads.frame.bytes,
+    (unsigned long long)uploads.frame.writes, (unsigned long long)uploads.frame.copies);
+}
+// state calls of a render pass
+void ImGui_passStats(const WGPU::RenderPass::Counters& counters) {
+  ImGui::Text("state calls %llu, %llu skipped", (unsigned long long)counters.issued,
+    (unsigned long long)counters.skipped);
+}
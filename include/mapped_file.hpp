@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file. `data` is nullptr if the file
+// could not be opened, is empty, or could not be mapped.
+class MappedFile {
+public:
+  const char* data = nullptr;
+  size_t size = 0;
+
+  MappedFile() {}
+
+  MappedFile(const std::string& file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED) {
+        madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(ptr);
+        size = st.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) : data(other.data), size(other.size) {
+    other.data = nullptr;
+    other.size = 0;
+  }
+
+  ~MappedFile() {
+    if (data) munmap(const_cast<char*>(data), size);
+  }
+
+  explicit operator bool() const { return data != nullptr; }
+
+  const char* begin() const { return data; }
+  const char* end() const { return data + size; }
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -140,6 +141,97 @@ namespace math {
     mat(3, 3) = 1;
   };
 
+  // Poses of many instances as structure of arrays, one array per
+  // component: a position and a unit quaternion each.
+  struct Poses {
+    const float* x, * y, * z;
+    const float* qx, * qy, * qz, * qw;
+  };
+
+  namespace detail {
+    // instances per packet: 8 on AVX, 4 on SSE and NEON, 1 without SIMD
+    constexpr int lanes = Eigen::internal::packet_traits<float>::size;
+    using Packet = Eigen::Array<float, lanes, 1>;
+
+    // The model matrices of the instances from first, as rotation() then
+    // translation by the position, one packet per entry in column-major
+    // order. Lanes past count repeat the last instance.
+    inline void models(const Poses& poses, size_t first, size_t count, Packet (&m)[16]) {
+      Packet x, y, z, w, px, py, pz;
+      if (first + lanes <= count) {
+        x = Packet::Map(poses.qx + first); y = Packet::Map(poses.qy + first);
+        z = Packet::Map(poses.qz + first); w = Packet::Map(poses.qw + first);
+        px = Packet::Map(poses.x + first); py = Packet::Map(poses.y + first); pz = Packet::Map(poses.z + first);
+      }
+      else
+        for (size_t i = 0; i < lanes; i++) {
+          size_t j = first + std::min(i, count - first - 1);
+          x[i] = poses.qx[j]; y[i] = poses.qy[j]; z[i] = poses.qz[j]; w[i] = poses.qw[j];
+          px[i] = poses.x[j]; py[i] = poses.y[j]; pz[i] = poses.z[j];
+        }
+      Packet x2 = x + x, y2 = y + y, z2 = z + z;
+      Packet xx = x * x2, xy = x * y2, xz = x * z2;
+      Packet yy = y * y2, yz = y * z2, zz = z * z2;
+      Packet wx = w * x2, wy = w * y2, wz = w * z2;
+
+      m[0] = 1 - (yy + zz); m[1] = xy - wz; m[2] = xz + wy; m[3] = 0;
+      m[4] = xy + wz; m[5] = 1 - (xx + zz); m[6] = yz - wx; m[7] = 0;
+      m[8] = xz - wy; m[9] = yz + wx; m[10] = 1 - (xx + yy); m[11] = 0;
+      m[12] = px; m[13] = py; m[14] = pz; m[15] = 1;
+    }
+
+    // Writes the first n lanes of 16 packets as n column-major matrices.
+    // Full packets go through square blocks that Eigen transposes in
+    // registers.
+    inline void store(const Packet (&m)[16], size_t n, float* out) {
+      if (n < lanes) {
+        for (size_t i = 0; i < n; i++)
+          for (int k = 0; k < 16; k++) out[i * 16 + k] = m[k][i];
+        return;
+      }
+      Eigen::Matrix<float, lanes, lanes> block;
+      for (int first = 0; first < 16; first += lanes) {
+        for (int i = 0; i < lanes; i++) block.col(i) = m[first + i].matrix();
+        block.transposeInPlace();
+        for (int i = 0; i < lanes; i++) {
+          Eigen::Map<Eigen::Matrix<float, lanes, 1>> column(out + i * 16 + first);
+          column = block.col(i);
+        }
+      }
+    }
+  }
+
+  // Writes the model matrices of count instances, rotation() of their
+  // quaternion then translation by their position, as 16 column-major
+  // floats each: ready to upload as an array<mat4x4f>.
+  //
+  // The batch variants run a packet of instances at a time in Eigen arrays,
+  // which compile to SSE/AVX or NEON and to scalar code without SIMD.
+  inline void models(const Poses& poses, size_t count, float* out) {
+    detail::Packet m[16];
+    for (size_t first = 0; first < count; first += detail::lanes) {
+      detail::models(poses, first, count, m);
+      detail::store(m, std::min<size_t>(detail::lanes, count - first), out + first * 16);
+    }
+  }
+
+  // Writes viewProjection * model of count instances, with models() in the
+  // same layout.
+  inline void modelViewProjections(const Eigen::Matrix4f& viewProjection, const Poses& poses, size_t count, float* out) {
+    detail::Packet m[16], mvp[16];
+    for (size_t first = 0; first < count; first += detail::lanes) {
+      detail::models(poses, first, count, m);
+      // the bottom row of a model is (0, 0, 0, 1)
+      for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++) {
+          const detail::Packet* col = m + c * 4;
+          mvp[c * 4 + r] = viewProjection(r, 0) * col[0] + viewProjection(r, 1) * col[1] + viewProjection(r, 2) * col[2];
+          if (c == 3) mvp[c * 4 + r] += viewProjection(r, 3);
+        }
+      detail::store(mvp, std::min<size_t>(detail::lanes, count - first), out + first * 16);
+    }
+  }
+
   inline Eigen::Ref<Eigen::Vector3f> arcballHolroyd(Eigen::Ref<Eigen::Vector3f> out, Eigen::Vector2f p, float radius = 2.) {
     float r2 = radius * radius, h = p.squaredNorm();
     float z = h <= r2 * .5f ? std::sqrt(r2 - h) : r2 / (2.f * std::sqrt(h));
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include "parallel.hpp"
+
+// CPU-side preprocessing passes over flat xyz position arrays.
+namespace mesh {
+  using Points = Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+  // Running statistics of positions, gathered in one pass over each batch:
+  // enough to apply normalize() and colorFromBounds() one batch at a time.
+  struct Stats {
+    Eigen::RowVector3d sum = Eigen::RowVector3d::Zero();
+    Eigen::RowVector3f lo = Eigen::RowVector3f::Constant(INFINITY);
+    Eigen::RowVector3f hi = Eigen::RowVector3f::Constant(-INFINITY);
+    size_t count = 0;
+
+    // Sum, minimum and maximum fused into one pass. 4 xyz vertices are 3
+    // packets of 4 floats whose lanes hold xyzx, yzxy and zxyz, so the
+    // packets accumulate as they are and the lanes are folded per axis at
+    // the end of every block. Blocks bound the float error of the sums
+    // before they move into doubles.
+    void add(const float* positions, size_t n) {
+      using Packet = Eigen::Array4f;
+      constexpr size_t block = 4096;
+      for (size_t first = 0; first < n; first += block) {
+        size_t end = std::min(n, first + block), i = first;
+        Packet s[3], a[3], b[3];
+        for (int j = 0; j < 3; j++) {
+          s[j] = Packet::Zero();
+          a[j] = Packet::Constant(INFINITY);
+          b[j] = Packet::Constant(-INFINITY);
+        }
+        for (; i + 4 <= end; i += 4)
+          for (int j = 0; j < 3; j++) {
+            Packet p = Packet::Map(positions + i * 3 + j * 4);
+            s[j] += p;
+            a[j] = a[j].min(p);
+            b[j] = b[j].max(p);
+          }
+        for (int j = 0; j < 3; j++)
+          for (int l = 0; l < 4; l++) {
+            int k = (j * 4 + l) % 3;
+            sum[k] += s[j][l];
+            lo[k] = std::min(lo[k], a[j][l]);
+            hi[k] = std::max(hi[k], b[j][l]);
+          }
+        for (; i < end; i++)
+          for (int k = 0; k < 3; k++) {
+            float v = positions[i * 3 + k];
+            sum[k] += v;
+            lo[k] = std::min(lo[k], v);
+            hi[k] = std::max(hi[k], v);
+          }
+      }
+      count += n;
+    }
+
+    void merge(const Stats& other) {
+      sum += other.sum;
+      lo = lo.cwiseMin(other.lo);
+      hi = hi.cwiseMax(other.hi);
+      count += other.count;
+    }
+
+    Eigen::RowVector3f mean() const { return (sum / double(count)).cast<float>(); }
+    float scale() const { return hi.maxCoeff(); }
+
+    // bounds after normalize()
+    void normalizedBounds(float* outLo, float* outHi) const {
+      Eigen::RowVector3f a = (lo - mean()) / scale(), b = (hi - mean()) / scale();
+      Eigen::Map<Eigen::RowVector3f>(outLo, 3) = a.cwiseMin(b);
+      Eigen::Map<Eigen::RowVector3f>(outHi, 3) = a.cwiseMax(b);
+    }
+
+    // the statistics of the positions normalize() writes
+    Stats normalized() const {
+      Stats out;
+      normalizedBounds(out.lo.data(), out.hi.data());
+      out.sum = (sum - mean().cast<double>() * double(count)) / double(scale());
+      out.count = count;
+      return out;
+    }
+  };
+
+  // Writes (in - offset) * scale per axis of count xyz vertices, which may
+  // be in place. Runs 4 vertices at a time as 3 packets whose lanes cycle
+  // through the axes like those of Stats::add().
+  inline void scaleOffset(const float* in, size_t count, const Eigen::Array3f& offset, const Eigen::Array3f& scale, float* out) {
+    using Packet = Eigen::Array4f;
+    Packet o[3], m[3];
+    for (int j = 0; j < 3; j++)
+      for (int l = 0; l < 4; l++) {
+        o[j][l] = offset[(j * 4 + l) % 3];
+        m[j][l] = scale[(j * 4 + l) % 3];
+      }
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+      for (int j = 0; j < 3; j++)
+        Packet::Map(out + i * 3 + j * 4) = (Packet::Map(in + i * 3 + j * 4) - o[j]) * m[j];
+    for (size_t j = i * 3; j < count * 3; j++) out[j] = (in[j] - offset[j % 3]) * scale[j % 3];
+  }
+
+  // Stats of all positions, chunks of them gathered on up to `threads`
+  // threads (0 = all cores).
+  inline Stats statsOf(const float* positions, size_t count, unsigned threads = 0) {
+    size_t chunks = std::max<size_t>(1, count / 65536);
+    std::vector<Stats> partial(chunks);
+    parallel::forChunks(count, chunks, [&](size_t c, size_t begin, size_t end) {
+      partial[c].add(positions + begin * 3, end - begin);
+      }, threads);
+    for (size_t c = 1; c < chunks; c++) partial[0].merge(partial[c]);
+    return partial[0];
+  }
+
+  // Centers positions on their mean and divides by the largest coordinate.
+  inline void normalize(float* positions, size_t count, unsigned threads = 0) {
+    Stats stats = statsOf(positions, count, threads);
+    Eigen::Array3f mean = stats.mean().array(), scale = Eigen::Array3f::Constant(1 / stats.scale());
+    parallel::forChunks(count, std::max<size_t>(1, count / 65536), [&](size_t, size_t begin, size_t end) {
+      scaleOffset(positions + begin * 3, end - begin, mean, scale, positions + begin * 3);
+      }, threads);
+  }
+
+  inline void bounds(const float* positions, size_t count, float* lo, float* hi) {
+    Stats stats = statsOf(positions, count);
+    std::copy_n(stats.lo.data(), 3, lo);
+    std::copy_n(stats.hi.data(), 3, hi);
+  }
+
+  // Maps every position into [0, 1] per axis of the bounds lo, hi.
+  inline void colorFromBounds(const float* positions, size_t count, const Eigen::RowVector3f& lo,
+    const Eigen::RowVector3f& hi, float* colors)
+  {
+    scaleOffset(positions, count, lo.array(), (hi - lo).array().inverse(), colors);
+  }
+
+  // Maps every position into [0, 1] per axis of the bounding box.
+  inline void colorFromBounds(const float* positions, size_t count, float* colors, unsigned threads = 0) {
+    Stats stats = statsOf(positions, count, threads);
+    parallel::forChunks(count, std::max<size_t>(1, count / 65536), [&](size_t, size_t begin, size_t end) {
+      colorFromBounds(positions + begin * 3, end - begin, stats.lo, stats.hi, colors + begin * 3);
+      }, threads);
+  }
+
+  // normalize() followed by colorFromBounds() on one batch of a mesh whose
+  // statistics were gathered up front. Colors are skipped if nullptr.
+  inline void normalizeBatch(const Stats& stats, float* positions, size_t count, float* colors) {
+    scaleOffset(positions, count, stats.mean().array(), Eigen::Array3f::Constant(1 / stats.scale()), positions);
+    if (!colors) return;
+
+    Stats normalized = stats.normalized();
+    colorFromBounds(positions, count, normalized.lo, normalized.hi, colors);
+  }
+
+  // A cluster of a split index buffer, drawn with
+  // drawIndexed(indexCount, 1, firstIndex, baseVertex).
+  struct Cluster {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t baseVertex;
+    uint32_t vertexCount;
+  };
+
+  // A level of detail stored after the full mesh in the same index buffer,
+  // over the same vertices. error is the largest geometric deviation from
+  // the full mesh, in position units.
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t padding = 0;
+  };
+
+  // A run of consecutive triangles, culled as a whole before drawing. The
+  // sphere bounds its vertices and every triangle normal lies within
+  // coneAngle radians of coneAxis; an angle of pi/2 or more never culls.
+  struct Meshlet {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    float center[3] = {};
+    float radius = 0;
+    float coneAxis[3] = {};
+    float coneAngle = 0;
+    uint32_t padding = 0;
+  };
+
+  // Splits a triangle list into clusters that reference at most maxVertices
+  // vertices each, so every cluster can be drawn with 16-bit indices relative
+  // to its base vertex. Triangles keep their order and vertices shared by two
+  // clusters are duplicated. remap receives the source vertex of every output
+  // vertex and is applied to each attribute stream with remapStream().
+  template <typename Index>
+  inline std::vector<Cluster> split16(
+    const Index* indices, size_t count, size_t vertexCount,
+    std::vector<uint16_t>& out, std::vector<uint32_t>& remap, size_t maxVertices = 1 << 16)
+  {
+    std::vector<Cluster> clusters;
+    std::vector<uint32_t> owner(vertexCount, UINT32_MAX), local(vertexCount);
+    out.clear();
+    out.reserve(count);
+    remap.clear();
+    remap.reserve(vertexCount);
+
+    uint32_t id = 0;
+    Cluster cluster{ 0, 0, 0, 0 };
+    for (size_t t = 0; t + 3 <= count; t += 3) {
+      uint32_t fresh = 0;
+      for (int k = 0; k < 3; k++) fresh += owner[indices[t + k]] != id;
+      if (cluster.vertexCount + fresh > maxVertices) {
+        clusters.push_back(cluster);
+        cluster = { uint32_t(out.size()), 0, int32_t(remap.size()), 0 };
+        id++;
+      }
+      for (int k = 0; k < 3; k++) {
+        uint32_t v = indices[t + k];
+        if (owner[v] != id) {
+          owner[v] = id;
+          local[v] = cluster.vertexCount++;
+          remap.push_back(v);
+        }
+        out.push_back(local[v]);
+      }
+      cluster.indexCount += 3;
+    }
+    if (cluster.indexCount) clusters.push_back(cluster);
+    return clusters;
+  }
+
+  // dst[i] = src[remap[i]] for an attribute stream of `components` values per vertex
+  template <typename T>
+  inline void remapStream(const T* src, size_t components, const std::vector<uint32_t>& remap, T* dst) {
+    for (size_t i = 0; i < remap.size(); i++)
+      std::copy_n(src + size_t(remap[i]) * components, components, dst + i * components);
+  }
+}
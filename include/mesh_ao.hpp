@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include "mesh_bvh.hpp"
+#include "parallel.hpp"
+
+// Ambient occlusion baked per vertex.
+namespace mesh {
+  // Writes the visibility of every vertex: the fraction of cosine-weighted
+  // rays over the hemisphere around its normal that travel `distance`
+  // without hitting a triangle of bvh, 1 when nothing is near. Vertices with
+  // a zero normal get 1. samples is rounded up to a multiple of 8.
+  //
+  // The rays of a vertex share their origin and are traced 8 at a time with
+  // Bvh::occluded(). Directions are stratified and rotated by a per-vertex
+  // angle, so neighbors do not band in the same directions and the result
+  // does not depend on the thread count. Vertices are spread
+  // over up to `threads` threads (0 = all cores) in small chunks, since
+  // vertices in crevices cost much more than open ones.
+  inline void bakeOcclusion(const Bvh& bvh, const float* positions, const float* normals, size_t vertexCount,
+    float* visibility, unsigned samples = 32, float distance = .1f, unsigned threads = 0)
+  {
+    using Packet = Bvh::Packet;
+    samples = (std::max(samples, 1u) + 7) & ~7u;
+    // lifts the origins off their surface
+    float bias = distance * 1e-4f;
+
+    // the cosine-weighted set in the frame of the normal, before rotation.
+    // Every packet of 8 covers one sector of azimuths, at 8 stratified
+    // heights, so its rays stay close and share most of their traversal.
+    size_t sectors = samples / 8;
+    std::vector<float> radius(samples), angle(samples), height(samples);
+    for (unsigned i = 0; i < samples; i++) {
+      unsigned lane = i % 8;
+      float u = (lane + .5f) / 8, v = (i / 8 + (lane * 5 % 8 + .5f) / 8) / sectors;
+      radius[i] = std::sqrt(u);
+      angle[i] = 2 * float(M_PI) * v;
+      height[i] = std::sqrt(1 - u);
+    }
+
+    size_t chunks = std::max<size_t>(1, vertexCount / 256);
+    parallel::forChunks(vertexCount, chunks, [&](size_t, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        Eigen::Map<const Eigen::Vector3f> n(normals + i * 3);
+        if (n.squaredNorm() == 0) {
+          visibility[i] = 1;
+          continue;
+        }
+
+        // orthonormal basis around n without branches on its direction,
+        // from Duff et al. 2017
+        float sign = std::copysign(1.f, n.z());
+        float a = -1 / (sign + n.z()), b = n.x() * n.y() * a;
+        Eigen::Vector3f t(1 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+        Eigen::Vector3f s(b, sign + n.y() * n.y() * a, -n.y());
+        Eigen::Vector3f origin = Eigen::Map<const Eigen::Vector3f>(positions + i * 3) + n * bias;
+
+        uint64_t h = (i + 1) * 0x9e3779b97f4a7c15ull;
+        float rotation = float((h ^ (h >> 31)) >> 40) * 0x1p-24f * 2 * float(M_PI);
+
+        unsigned blocked = 0;
+        for (unsigned j = 0; j < samples; j += 8) {
+          Packet x, y, z;
+          for (int k = 0; k < 8; k++) {
+            float phi = angle[j + k] + rotation;
+            x[k] = radius[j + k] * std::cos(phi);
+            y[k] = radius[j + k] * std::sin(phi);
+            z[k] = height[j + k];
+          }
+          Packet directions[3] = {
+            x * t.x() + y * s.x() + z * n.x(),
+            x * t.y() + y * s.y() + z * n.y(),
+            x * t.z() + y * s.z() + z * n.z(),
+          };
+          blocked += std::popcount(bvh.occluded(origin, directions, distance));
+        }
+        visibility[i] = 1 - float(blocked) / samples;
+      }
+      }, threads);
+  }
+}
@@ -0,0 +1,508 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+#include "parallel.hpp"
+
+// Bounding volume hierarchy over the triangles of a mesh, for ray queries
+// such as picking.
+namespace mesh {
+  struct Ray {
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;
+
+    // The ray through a point in normalized device coordinates, from the
+    // near plane to the far plane of clip, the projection * view * model
+    // matrix with WebGPU depth [0, 1]. The ray is in the space clip maps
+    // from.
+    static Ray unproject(const Eigen::Matrix4f& clip, const Eigen::Vector2f& ndc) {
+      Eigen::Matrix4f inverse = clip.inverse();
+      Eigen::Vector4f a = inverse * Eigen::Vector4f(ndc.x(), ndc.y(), 0, 1);
+      Eigen::Vector4f b = inverse * Eigen::Vector4f(ndc.x(), ndc.y(), 1, 1);
+      Eigen::Vector3f origin = a.head<3>() / a.w();
+      return { origin, b.head<3>() / b.w() - origin };
+    }
+
+    Eigen::Vector3f at(float t) const { return origin + t * direction; }
+  };
+
+  // The nearest intersection of a ray: its parameter along the ray, the
+  // source triangle and the barycentrics of the hit point toward its
+  // second and third vertex.
+  struct RayHit {
+    float t = INFINITY;
+    uint32_t triangle = ~0u;
+    float u = 0;
+    float v = 0;
+
+    explicit operator bool() const { return triangle != ~0u; }
+  };
+
+  class Bvh {
+  public:
+    // 8 rays at once, one lane each
+    using Packet = Eigen::Array<float, 8, 1>;
+
+    // Leaves have count > 0 triangles from first in triangles; inner nodes
+    // have count = 0 and their children at first and first + 1.
+    struct Node {
+      float min[3];
+      uint32_t first;
+      float max[3];
+      uint32_t count;
+    };
+
+    std::vector<Node> nodes;
+    // the source triangle of every leaf slot
+    std::vector<uint32_t> triangles;
+    // the most inner nodes on a path from the root to a leaf, which bounds
+    // the traversal stacks
+    uint32_t depth = 0;
+
+    Bvh() = default;
+
+    // Builds the hierarchy with a binned surface area heuristic. Nodes too
+    // large for one thread are split with every thread binning a part of
+    // them; the subtrees below are then built in parallel, each on one
+    // thread. Runs on up to `threads` threads (0 = all cores).
+    template <typename Index>
+    Bvh(const Index* indices, size_t count, const float* positions, unsigned threads = 0) {
+      size_t n = count / 3;
+      triangles.resize(n);
+      std::vector<Box> boxes(n);
+      parallel::forRange(n, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+          triangles[t] = uint32_t(t);
+          for (int k = 0; k < 3; k++) {
+            const float* p = positions + size_t(indices[t * 3 + k]) * 3;
+            boxes[t].grow(Eigen::Array4f(p[0], p[1], p[2], 0));
+          }
+        }
+        }, threads);
+      build(boxes, threads);
+
+      // the vertex and the two edges of every triangle in leaf order, so
+      // leaves read contiguous memory
+      vertices.resize(n * 9);
+      parallel::forRange(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          const Index* f = indices + size_t(triangles[i]) * 3;
+          Eigen::Map<const Eigen::Vector3f> a(positions + size_t(f[0]) * 3), b(positions + size_t(f[1]) * 3), c(positions + size_t(f[2]) * 3);
+          Eigen::Map<Eigen::Vector3f> v(&vertices[i * 9]), e1(&vertices[i * 9 + 3]), e2(&vertices[i * 9 + 6]);
+          v = a;
+          e1 = b - a;
+          e2 = c - a;
+        }
+        }, threads);
+    }
+
+    explicit operator bool() const { return !nodes.empty(); }
+
+    // The nearest hit of ray with a triangle of either winding before tMax.
+    RayHit intersect(const Ray& ray, float tMax = INFINITY) const {
+      RayHit hit;
+      hit.t = tMax;
+      if (nodes.empty()) return hit;
+
+      Eigen::Vector3f inverse = ray.direction.cwiseInverse();
+      // entry distance of the ray into a node, INFINITY when it misses or
+      // enters behind the current hit
+      auto enter = [&](const Node& node) {
+        float near = 0, far = hit.t;
+        for (int k = 0; k < 3; k++) {
+          float a = (node.min[k] - ray.origin[k]) * inverse[k];
+          float b = (node.max[k] - ray.origin[k]) * inverse[k];
+          near = std::max(near, std::min(a, b));
+          far = std::min(far, std::max(a, b));
+        }
+        return near <= far ? near : INFINITY;
+      };
+
+      struct Entry {
+        uint32_t node;
+        float distance;
+      };
+      // the far child of every inner node on the way down, on the heap only
+      // for hierarchies deeper than real meshes get
+      Entry local[64];
+      std::vector<Entry> heap(depth > 64 ? depth : 0);
+      Entry* stack = heap.empty() ? local : heap.data();
+      size_t size = 0;
+      float distance = enter(nodes[0]);
+      for (uint32_t i = 0; distance < INFINITY;) {
+        const Node& node = nodes[i];
+        if (node.count) {
+          for (uint32_t s = node.first; s < node.first + node.count; s++) intersectTriangle(ray, s, hit);
+        }
+        else {
+          uint32_t near = node.first, far = node.first + 1;
+          float dNear = enter(nodes[near]), dFar = enter(nodes[far]);
+          if (dFar < dNear) {
+            std::swap(near, far);
+            std::swap(dNear, dFar);
+          }
+          if (dNear < INFINITY) {
+            if (dFar < INFINITY) stack[size++] = { far, dFar };
+            i = near;
+            continue;
+          }
+        }
+        // the next node on the stack that the ray still enters before the hit
+        for (distance = INFINITY; size && distance == INFINITY;) {
+          Entry e = stack[--size];
+          if (e.distance < hit.t) {
+            i = e.node;
+            distance = e.distance;
+          }
+        }
+      }
+      return hit;
+    }
+
+    // Which of 8 rays from origin along directions hit a triangle of either
+    // winding before tMax, as a bit per ray. Any hit ends a ray, so rays
+    // are not ordered and the query stops once every ray is blocked. Boxes
+    // and triangles are tested against all 8 rays at once in packets.
+    uint32_t occluded(const Eigen::Vector3f& origin, const Packet (&directions)[3], float tMax) const {
+      if (nodes.empty()) return 0;
+      Packet inverse[3], offset[3];
+      for (int k = 0; k < 3; k++) {
+        inverse[k] = directions[k].inverse();
+        offset[k] = -origin[k] * inverse[k];
+      }
+      // how far every ray still has to go, -1 once it is blocked
+      Packet limit = Packet::Constant(tMax);
+
+      // both children of every inner node on the way down, less the one
+      // taken
+      uint32_t local[64];
+      std::vector<uint32_t> heap(depth + 1 > 64 ? depth + 1 : 0);
+      uint32_t* stack = heap.empty() ? local : heap.data();
+      stack[0] = 0;
+      size_t size = 1;
+      while (size) {
+        const Node& node = nodes[stack[--size]];
+        Packet near = Packet::Zero(), far = limit;
+        for (int k = 0; k < 3; k++) {
+          Packet a = node.min[k] * inverse[k] + offset[k];
+          Packet b = node.max[k] * inverse[k] + offset[k];
+          near = near.max(a.min(b));
+          far = far.min(a.max(b));
+        }
+        if (!(near <= far).any()) continue;
+        if (!node.count) {
+          stack[size++] = node.first;
+          stack[size++] = node.first + 1;
+          continue;
+        }
+
+        // Moller-Trumbore, where everything that depends only on the shared
+        // origin is computed once
+        for (uint32_t s = node.first; s < node.first + node.count; s++) {
+          Eigen::Map<const Eigen::Vector3f> a(&vertices[size_t(s) * 9]), e1(&vertices[size_t(s) * 9 + 3]), e2(&vertices[size_t(s) * 9 + 6]);
+          Eigen::Vector3f d = origin - a, q = d.cross(e1);
+          Packet p[3] = {
+            directions[1] * e2.z() - directions[2] * e2.y(),
+            directions[2] * e2.x() - directions[0] * e2.z(),
+            directions[0] * e2.y() - directions[1] * e2.x(),
+          };
+          Packet inv = (p[0] * e1.x() + p[1] * e1.y() + p[2] * e1.z()).inverse();
+          Packet u = (p[0] * d.x() + p[1] * d.y() + p[2] * d.z()) * inv;
+          Packet v = (directions[0] * q.x() + directions[1] * q.y() + directions[2] * q.z()) * inv;
+          Packet t = e2.dot(q) * inv;
+          limit = (u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t < limit).select(Packet::Constant(-1), limit);
+        }
+        if ((limit < 0).all()) return 0xff;
+      }
+
+      uint32_t mask = 0;
+      for (int i = 0; i < 8; i++) mask |= uint32_t(limit[i] < 0) << i;
+      return mask;
+    }
+
+  private:
+    static constexpr int binCount = 16;
+    static constexpr uint32_t maxLeafSize = 8;
+
+    // with a w lane that stays 0, so min and max run 4 wide
+    struct Box {
+      Eigen::Array4f lo = Eigen::Array4f(INFINITY, INFINITY, INFINITY, 0);
+      Eigen::Array4f hi = Eigen::Array4f(-INFINITY, -INFINITY, -INFINITY, 0);
+
+      void grow(const Eigen::Array4f& p) {
+        lo = lo.min(p);
+        hi = hi.max(p);
+      }
+
+      void grow(const Box& b) {
+        lo = lo.min(b.lo);
+        hi = hi.max(b.hi);
+      }
+
+      Eigen::Array4f center() const { return (lo + hi) * .5f; }
+
+      float area() const {
+        Eigen::Array4f d = (hi - lo).max(0.f);
+        return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+      }
+    };
+
+    // a node to split, with the bounds of its triangles and of their centers
+    struct Task {
+      uint32_t node;
+      uint32_t first;
+      uint32_t count;
+      Box bounds = {};
+      Box centers = {};
+    };
+
+    struct Bin {
+      Box box;
+      uint32_t count = 0;
+    };
+    using Bins = std::array<std::array<Bin, binCount>, 3>;
+
+    std::vector<float> vertices;
+
+    // Moller-Trumbore against leaf slot s
+    void intersectTriangle(const Ray& ray, uint32_t s, RayHit& hit) const {
+      Eigen::Map<const Eigen::Vector3f> a(&vertices[size_t(s) * 9]), e1(&vertices[size_t(s) * 9 + 3]), e2(&vertices[size_t(s) * 9 + 6]);
+      Eigen::Vector3f p = ray.direction.cross(e2);
+      float det = e1.dot(p);
+      if (det == 0) return;
+      float inverse = 1 / det;
+      Eigen::Vector3f d = ray.origin - a;
+      float u = d.dot(p) * inverse;
+      if (u < 0 || u > 1) return;
+      Eigen::Vector3f q = d.cross(e1);
+      float v = ray.direction.dot(q) * inverse;
+      if (v < 0 || u + v > 1) return;
+      float t = e2.dot(q) * inverse;
+      if (t < 0 || t >= hit.t) return;
+      hit = { t, triangles[s], u, v };
+    }
+
+    // bounds of the triangles in [first, first + count) and of their centers
+    void measure(Task& task, std::vector<Box>& boxes) const {
+      task.bounds = task.centers = Box();
+      for (uint32_t i = task.first; i < task.first + task.count; i++) {
+        task.bounds.grow(boxes[i]);
+        task.centers.grow(boxes[i].center());
+      }
+    }
+
+    // Writes the bounds of the node of task and splits its triangles at the
+    // cheapest of the bin boundaries on every axis, binning on `threads`
+    // threads into bins, one Bins per thread. Returns false when the node
+    // is cheaper as a leaf, and otherwise the two halves in left and right.
+    bool split(const Task& task, Node& node, Task& left, Task& right,
+      std::vector<Box>& boxes, std::vector<Bins>& bins, unsigned threads)
+    {
+      Eigen::Map<Eigen::Vector3f>(node.min) = task.bounds.lo.head<3>();
+      Eigen::Map<Eigen::Vector3f>(node.max) = task.bounds.hi.head<3>();
+      if (task.count <= 1) return false;
+
+      // small nodes get fewer bins, their setup and sweep dominate otherwise
+      int used = std::clamp(int(task.count / 2), 4, binCount);
+      const Box& range = task.centers;
+      Eigen::Array4f extent = range.hi - range.lo;
+      Eigen::Array4f scale = (extent > 0).select(float(used) / extent, Eigen::Array4f::Zero());
+      auto binOf = [&](const Eigen::Array4f& c, int k) {
+        return std::min(used - 1, int((c[k] - range.lo[k]) * scale[k]));
+      };
+
+      for (Bins& own : bins)
+        for (auto& row : own) std::fill(row.begin(), row.begin() + used, Bin());
+      parallel::forChunks(task.count, bins.size(), [&](size_t c, size_t begin, size_t end) {
+        Bins& own = bins[c];
+        for (size_t i = task.first + begin; i < task.first + end; i++) {
+          Eigen::Array4f center = boxes[i].center();
+          for (int k = 0; k < 3; k++) {
+            Bin& bin = own[k][binOf(center, k)];
+            bin.box.grow(boxes[i]);
+            bin.count++;
+          }
+        }
+        }, threads);
+      for (size_t c = 1; c < bins.size(); c++)
+        for (int k = 0; k < 3; k++)
+          for (int b = 0; b < used; b++) {
+            bins[0][k][b].box.grow(bins[c][k][b].box);
+            bins[0][k][b].count += bins[c][k][b].count;
+          }
+
+      // cost of a split relative to intersecting all triangles of the node,
+      // with a traversal step as expensive as a triangle
+      float best = INFINITY;
+      int axis = -1, boundary = 0;
+      Box leftBounds, rightBounds;
+      for (int k = 0; k < 3; k++) {
+        if (scale[k] == 0) continue;
+        const auto& row = bins[0][k];
+        Box right[binCount];
+        float rightCost[binCount];
+        uint32_t n = 0;
+        for (int b = used - 1; b > 0; b--) {
+          if (b < used - 1) right[b] = right[b + 1];
+          right[b].grow(row[b].box);
+          n += row[b].count;
+          rightCost[b] = n ? right[b].area() * n : 0;
+        }
+        Box box;
+        n = 0;
+        for (int b = 1; b < used; b++) {
+          box.grow(row[b - 1].box);
+          n += row[b - 1].count;
+          if (n == 0 || n == task.count) continue;
+          float cost = box.area() * n + rightCost[b];
+          if (cost < best) {
+            best = cost;
+            axis = k;
+            boundary = b;
+            leftBounds = box;
+            rightBounds = right[b];
+          }
+        }
+      }
+
+      float parent = task.bounds.area();
+      float splitCost = parent > 0 ? 1 + best / parent : INFINITY;
+      if (task.count <= maxLeafSize && (axis < 0 || splitCost >= task.count)) return false;
+
+      if (axis < 0) {
+        // all centers coincide: halve the node
+        left = { task.node, task.first, task.count / 2 };
+        right = { task.node, task.first + left.count, task.count - left.count };
+        measure(left, boxes);
+        measure(right, boxes);
+        return true;
+      }
+
+      // partition, collecting the center bounds of both sides
+      left = { task.node, task.first, 0, leftBounds };
+      right = { task.node, 0, 0, rightBounds };
+      uint32_t i = task.first, j = task.first + task.count;
+      while (i < j) {
+        Eigen::Array4f c = boxes[i].center();
+        if (binOf(c, axis) < boundary) {
+          left.centers.grow(c);
+          i++;
+        }
+        else {
+          right.centers.grow(c);
+          j--;
+          std::swap(triangles[i], triangles[j]);
+          std::swap(boxes[i], boxes[j]);
+        }
+      }
+      left.count = i - task.first;
+      right.first = i;
+      right.count = task.count - left.count;
+      return true;
+    }
+
+    // Splits the node of root and everything below it on one thread, depth
+    // first, appending the nodes below it to out.
+    void buildSubtree(std::vector<Node>& out, const Task& root,
+      std::vector<Box>& boxes)
+    {
+      std::vector<Task> stack{ root };
+      std::vector<Bins> bins(1);
+      while (!stack.empty()) {
+        Task task = stack.back(), left, right;
+        stack.pop_back();
+        if (!split(task, out[task.node], left, right, boxes, bins, 1)) {
+          out[task.node].first = task.first;
+          out[task.node].count = task.count;
+          continue;
+        }
+        uint32_t child = uint32_t(out.size());
+        out[task.node].first = child;
+        out[task.node].count = 0;
+        out.resize(out.size() + 2);
+        left.node = child;
+        right.node = child + 1;
+        stack.push_back(right);
+        stack.push_back(left);
+      }
+    }
+
+    void build(std::vector<Box>& boxes, unsigned threads) {
+      threads = threads ? threads : parallel::threadCount();
+      uint32_t n = uint32_t(triangles.size());
+      nodes.clear();
+      depth = 0;
+      if (n == 0) return;
+      nodes.resize(1);
+
+      Task root{ 0, 0, n };
+      std::vector<Task> partial(threads);
+      parallel::forChunks(n, threads, [&](size_t c, size_t begin, size_t end) {
+        partial[c] = { 0, uint32_t(begin), uint32_t(end - begin) };
+        measure(partial[c], boxes);
+        }, threads);
+      for (auto& p : partial) {
+        root.bounds.grow(p.bounds);
+        root.centers.grow(p.centers);
+      }
+
+      // split nodes with all threads until there are enough subtrees to
+      // keep every thread busy
+      uint32_t grain = std::max<uint32_t>(n / (threads * 4), 1 << 14);
+      std::vector<Task> open{ root }, subtrees;
+      std::vector<Bins> bins(threads);
+      while (!open.empty()) {
+        Task task = open.back(), left, right;
+        open.pop_back();
+        if (task.count <= grain || threads == 1) {
+          subtrees.push_back(task);
+          continue;
+        }
+        if (!split(task, nodes[task.node], left, right, boxes, bins, threads)) {
+          nodes[task.node].first = task.first;
+          nodes[task.node].count = task.count;
+          continue;
+        }
+        uint32_t child = uint32_t(nodes.size());
+        nodes[task.node].first = child;
+        nodes[task.node].count = 0;
+        nodes.resize(nodes.size() + 2);
+        left.node = child;
+        right.node = child + 1;
+        open.push_back(left);
+        open.push_back(right);
+      }
+
+      // every subtree builds into its own nodes, whose root then replaces
+      // the placeholder and whose other nodes are appended
+      std::vector<std::vector<Node>> built(subtrees.size());
+      parallel::forChunks(subtrees.size(), subtrees.size(), [&](size_t s, size_t, size_t) {
+        Task root = subtrees[s];
+        root.node = 0;
+        built[s].resize(1);
+        buildSubtree(built[s], root, boxes);
+        }, threads);
+      for (size_t s = 0; s < subtrees.size(); s++) {
+        uint32_t base = uint32_t(nodes.size()) - 1;
+        for (Node& node : built[s])
+          if (!node.count) node.first += base;
+        nodes[subtrees[s].node] = built[s][0];
+        nodes.insert(nodes.end(), built[s].begin() + 1, built[s].end());
+      }
+
+      // children come after their parent, so one pass finds every level
+      std::vector<uint32_t> level(nodes.size(), 0);
+      for (size_t i = 0; i < nodes.size(); i++)
+        if (!nodes[i].count) {
+          level[nodes[i].first] = level[nodes[i].first + 1] = level[i] + 1;
+          depth = std::max(depth, level[i] + 1);
+        }
+    }
+  };
+}
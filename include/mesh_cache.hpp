@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+// Binary cache of a preprocessed mesh, stored next to its source file as
+// `<source>.cache`. Sections are 16-byte aligned and padded so every stream
+// can be handed to Buffer::write straight from the mapping.
+class MeshCache {
+public:
+  static constexpr char magic[8] = { 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+  static constexpr uint32_t version = 8;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t indexSize;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    float boundsMin[4];
+    float boundsMax[4];
+    uint64_t positionsOffset;
+    uint64_t colorsOffset;
+    uint64_t normalsOffset;
+    uint64_t indicesOffset;
+    uint64_t clusterCount;
+    uint64_t clustersOffset;
+    uint64_t lodCount;
+    uint64_t lodsOffset;
+    uint64_t meshletCount;
+    uint64_t meshletsOffset;
+    uint64_t fileSize;
+  };
+
+  const Header* header = nullptr;
+  const float* positions = nullptr;
+  const float* colors = nullptr;
+  const float* normals = nullptr;
+  const void* indices = nullptr;
+  const mesh::Cluster* clusters = nullptr;
+  const mesh::Lod* lods = nullptr;
+  const mesh::Meshlet* meshlets = nullptr;
+
+  static std::string path(const std::string& source) { return source + ".cache"; }
+
+  // 64-bit hash of a byte range, 8 bytes per step.
+  static uint64_t hash(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+    auto mix = [](uint64_t h, uint64_t v) {
+      v *= 0xbf58476d1ce4e5b9ull;
+      v ^= v >> 31;
+      h = (h ^ v) * 0x94d049bb133111ebull;
+      return h ^ (h >> 29);
+      };
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t v;
+      std::memcpy(&v, p + i, 8);
+      h = mix(h, v);
+    }
+    uint64_t tail = 0;
+    if (i < size) std::memcpy(&tail, p + i, size - i);
+    return mix(h, tail);
+  }
+
+  // Maps `<source>.cache` if it exists and matches the source. A source with
+  // the recorded size but a different modification time is re-hashed, so
+  // copies and checkouts of the same file still hit.
+  MeshCache(const std::string& source) : file(path(source)) {
+    if (!file || file.size < sizeof(Header)) return;
+
+    const Header* h = reinterpret_cast<const Header*>(file.data);
+    if (std::memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version || h->fileSize != file.size)
+      return;
+    if (h->positionsOffset + h->vertexCount * 3 * sizeof(float) > h->colorsOffset ||
+      h->colorsOffset + h->vertexCount * 3 * sizeof(float) > h->normalsOffset ||
+      h->normalsOffset + h->vertexCount * 3 * sizeof(float) > h->indicesOffset ||
+      h->indicesOffset + h->indexCount * h->indexSize > h->clustersOffset ||
+      h->clustersOffset + h->clusterCount * sizeof(mesh::Cluster) > h->lodsOffset ||
+      h->lodsOffset + h->lodCount * sizeof(mesh::Lod) > h->meshletsOffset ||
+      h->meshletsOffset + h->meshletCount * sizeof(mesh::Meshlet) > h->fileSize)
+      return;
+
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(source, ec);
+    if (ec || size != h->sourceSize) return;
+    if (modified(source) != h->sourceTime) {
+      MappedFile src(source);
+      if (!src || hash(src.data, src.size) != h->sourceHash) return;
+    }
+    view(file.data);
+  }
+
+  // Serializes preprocessed streams for `source`, writes them next to it and
+  // returns a cache viewing the in-memory image, so a read-only data
+  // directory still works.
+  template <typename Index>
+  static MeshCache build(
+    const std::string& source,
+    const std::vector<float>& positions,
+    const std::vector<float>& colors,
+    const std::vector<float>& normals,
+    const std::vector<Index>& indices,
+    const std::vector<mesh::Cluster>& clusters = {},
+    const std::vector<mesh::Lod>& lods = {},
+    const std::vector<mesh::Meshlet>& meshlets = {})
+  {
+    size_t vertexCount = positions.size() / 3;
+    Header h = layout(vertexCount, indices.size(), sizeof(Index), clusters.size(), lods.size(), meshlets.size());
+    mesh::bounds(positions.data(), vertexCount, h.boundsMin, h.boundsMax);
+    bool stamped = stamp(h, source);
+
+    MeshCache cache;
+    cache.storage.resize(h.fileSize, 0);
+    char* out = cache.storage.data();
+    std::memcpy(out, &h, sizeof(Header));
+    // data() of an empty vector may be null, which memcpy does not take
+    // even for 0 bytes
+    auto section = [&](uint64_t offset, const auto& v) {
+      if (!v.empty()) std::memcpy(out + offset, v.data(), v.size() * sizeof(v[0]));
+      };
+    section(h.positionsOffset, positions);
+    section(h.colorsOffset, colors);
+    section(h.normalsOffset, normals);
+    section(h.indicesOffset, indices);
+    section(h.clustersOffset, clusters);
+    section(h.lodsOffset, lods);
+    section(h.meshletsOffset, meshlets);
+    cache.view(out);
+
+    if (stamped) {
+      std::string tmp = path(source) + ".tmp";
+      if (FILE* file = fopen(tmp.c_str(), "wb")) {
+        bool ok = fwrite(out, 1, h.fileSize, file) == h.fileSize;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || std::rename(tmp.c_str(), path(source).c_str()) != 0) std::remove(tmp.c_str());
+      }
+    }
+    return cache;
+  }
+
+  // Writes a cache incrementally while a mesh is streamed, so it never has to
+  // be held in memory. Every section is appended to in order; the header goes
+  // in last and the file only replaces an existing cache on finish().
+  class Writer {
+  private:
+    std::string source;
+    std::string tmp;
+    FILE* file = nullptr;
+    Header h;
+    uint64_t written[4] = { 0, 0, 0, 0 };
+
+    void append(int section, uint64_t offset, const void* data, uint64_t bytes) {
+      if (!file) return;
+      if (fseeko(file, offset + written[section], SEEK_SET) != 0 || fwrite(data, 1, bytes, file) != bytes) {
+        fclose(file);
+        file = nullptr;
+        std::remove(tmp.c_str());
+      }
+      written[section] += bytes;
+    }
+
+  public:
+    Writer(const std::string& source, uint64_t vertexCount, uint64_t indexCount, uint32_t indexSize)
+      : source(source), tmp(path(source) + ".tmp"), h(layout(vertexCount, indexCount, indexSize)) {
+      file = fopen(tmp.c_str(), "wb");
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer() {
+      if (!file) return;
+      fclose(file);
+      std::remove(tmp.c_str());
+    }
+
+    explicit operator bool() const { return file != nullptr; }
+
+    void positions(const float* data, size_t count) { append(0, h.positionsOffset, data, count * 3 * sizeof(float)); }
+    void colors(const float* data, size_t count) { append(1, h.colorsOffset, data, count * 3 * sizeof(float)); }
+    void normals(const float* data, size_t count) { append(2, h.normalsOffset, data, count * 3 * sizeof(float)); }
+    void indices(const void* data, size_t count) { append(3, h.indicesOffset, data, count * h.indexSize); }
+
+    // Commits the cache once every section is complete.
+    bool finish(const float* boundsMin, const float* boundsMax) {
+      if (!file) return false;
+      bool ok = written[0] == h.vertexCount * 3 * sizeof(float) &&
+        written[1] == written[0] &&
+        written[2] == written[0] &&
+        written[3] == h.indexCount * h.indexSize &&
+        stamp(h, source);
+      if (ok) {
+        std::memcpy(h.boundsMin, boundsMin, 3 * sizeof(float));
+        std::memcpy(h.boundsMax, boundsMax, 3 * sizeof(float));
+        // extend the file to its padded size and put the header in front
+        char zero = 0;
+        ok = fseeko(file, h.fileSize - 1, SEEK_SET) == 0 && fwrite(&zero, 1, 1, file) == 1 &&
+          fseeko(file, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(Header), 1, file) == 1;
+      }
+      ok = fclose(file) == 0 && ok;
+      file = nullptr;
+      if (!ok || std::rename(tmp.c_str(), path(source).c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+      }
+      return true;
+    }
+  };
+
+  // an empty cache that is not valid
+  MeshCache() {}
+
+  explicit operator bool() const { return header != nullptr; }
+
+private:
+  MappedFile file;
+  std::vector<char> storage;
+
+  static uint64_t align(uint64_t offset) { return (offset + 15) & ~uint64_t(15); }
+
+  static Header layout(uint64_t vertexCount, uint64_t indexCount, uint32_t indexSize,
+    uint64_t clusterCount = 0, uint64_t lodCount = 0, uint64_t meshletCount = 0)
+  {
+    Header h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.indexSize = indexSize;
+    h.vertexCount = vertexCount;
+    h.indexCount = indexCount;
+    h.clusterCount = clusterCount;
+    h.lodCount = lodCount;
+    h.meshletCount = meshletCount;
+    h.positionsOffset = align(sizeof(Header));
+    h.colorsOffset = align(h.positionsOffset + vertexCount * 3 * sizeof(float));
+    h.normalsOffset = align(h.colorsOffset + vertexCount * 3 * sizeof(float));
+    h.indicesOffset = align(h.normalsOffset + vertexCount * 3 * sizeof(float));
+    h.clustersOffset = align(h.indicesOffset + indexCount * indexSize);
+    h.lodsOffset = align(h.clustersOffset + clusterCount * sizeof(mesh::Cluster));
+    h.meshletsOffset = align(h.lodsOffset + lodCount * sizeof(mesh::Lod));
+    h.fileSize = align(h.meshletsOffset + meshletCount * sizeof(mesh::Meshlet));
+    return h;
+  }
+
+  // records what the cache was built from
+  static bool stamp(Header& h, const std::string& source) {
+    MappedFile src(source);
+    if (!src) return false;
+    h.sourceSize = src.size;
+    h.sourceHash = hash(src.data, src.size);
+    h.sourceTime = modified(source);
+    return true;
+  }
+
+  static int64_t modified(const std::string& source) {
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(source, ec);
+    return ec ? 0 : t.time_since_epoch().count();
+  }
+
+  void view(const char* data) {
+    header = reinterpret_cast<const Header*>(data);
+    positions = reinterpret_cast<const float*>(data + header->positionsOffset);
+    colors = reinterpret_cast<const float*>(data + header->colorsOffset);
+    normals = reinterpret_cast<const float*>(data + header->normalsOffset);
+    indices = data + header->indicesOffset;
+    clusters = reinterpret_cast<const mesh::Cluster*>(data + header->clustersOffset);
+    lods = reinterpret_cast<const mesh::Lod*>(data + header->lodsOffset);
+    meshlets = reinterpret_cast<const mesh::Meshlet*>(data + header->meshletsOffset);
+  }
+};
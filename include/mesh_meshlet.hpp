@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include "mesh.hpp"
+#include "mesh_optimize.hpp"
+
+// Meshlets, small groups of triangles with bounds to cull against the view
+// frustum and a normal cone to cull when all of them face away, so only
+// the ranges that can be visible are drawn.
+namespace mesh {
+  // Groups the triangles of a list into meshlets of at most maxVertices
+  // distinct vertices and maxTriangles triangles and writes them to out in
+  // meshlet order. A meshlet grows from a seed triangle by the neighbor that
+  // adds the fewest vertices and, among those, deviates least from its
+  // normal cone, which keeps the bounds small and the cones narrow.
+  // firstIndex is the offset of the list in its index buffer.
+  template <typename Index>
+  inline std::vector<Meshlet> buildMeshlets(
+    const Index* indices, size_t count, const float* positions, size_t vertexCount, Index* out,
+    size_t maxVertices = 64, size_t maxTriangles = 124, uint32_t firstIndex = 0)
+  {
+    using Vec3 = Eigen::Vector3f;
+    auto point = [&](Index v) { return Eigen::Map<const Vec3>(positions + size_t(v) * 3); };
+    size_t triangles = count / 3;
+
+    // vertex -> triangles adjacency
+    std::vector<uint32_t> offsets(vertexCount + 1, 0), adjacency(triangles * 3);
+    for (size_t i = 0; i < triangles * 3; i++) offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangles * 3; i++) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+
+    std::vector<Vec3> normals(triangles);
+    for (size_t t = 0; t < triangles; t++) {
+      const Index* v = indices + t * 3;
+      Vec3 n = (point(v[1]) - point(v[0])).cross(point(v[2]) - point(v[0]));
+      normals[t] = n.squaredNorm() > 0 ? n.normalized() : Vec3::Zero();
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> owner(vertexCount, UINT32_MAX), vertices, candidates;
+    std::vector<char> emitted(triangles, 0);
+    size_t written = 0, cursor = 0, begin = 0;
+    Vec3 axis = Vec3::Zero();
+
+    // bounds and normal cone of the meshlet written since begin
+    auto finish = [&]() {
+      Meshlet m{
+        .firstIndex = uint32_t(firstIndex + begin),
+        .indexCount = uint32_t(written - begin),
+        .vertexCount = uint32_t(vertices.size()),
+      };
+      Vec3 lo = Vec3::Constant(INFINITY), hi = Vec3::Constant(-INFINITY);
+      for (uint32_t v : vertices) {
+        lo = lo.cwiseMin(point(Index(v)));
+        hi = hi.cwiseMax(point(Index(v)));
+      }
+      Vec3 center = (lo + hi) * .5f;
+      float radius = 0;
+      for (uint32_t v : vertices) radius = std::max(radius, (point(Index(v)) - center).norm());
+
+      float angle = float(M_PI);
+      if (axis.squaredNorm() > 0) {
+        axis.normalize();
+        float cosine = 1;
+        for (size_t i = begin; i < written; i += 3) {
+          Vec3 n = (point(out[i + 1]) - point(out[i])).cross(point(out[i + 2]) - point(out[i]));
+          if (n.squaredNorm() > 0) cosine = std::min(cosine, axis.dot(n.normalized()));
+        }
+        angle = std::acos(std::clamp(cosine, -1.f, 1.f));
+      }
+
+      std::copy(center.data(), center.data() + 3, m.center);
+      m.radius = radius;
+      std::copy(axis.data(), axis.data() + 3, m.coneAxis);
+      m.coneAngle = angle;
+      meshlets.push_back(m);
+      vertices.clear();
+      axis = Vec3::Zero();
+      begin = written;
+    };
+
+    auto fresh = [&](size_t t) {
+      uint32_t id = uint32_t(meshlets.size());
+      size_t n = 0;
+      for (int k = 0; k < 3; k++) n += owner[indices[t * 3 + k]] != id;
+      return n;
+    };
+
+    for (size_t emittedCount = 0; emittedCount < triangles; emittedCount++) {
+      // the neighbor adding the fewest vertices, then the one closest to the cone axis
+      int64_t best = -1;
+      size_t bestFresh = 4;
+      float bestDot = -INFINITY;
+      Vec3 direction = axis.squaredNorm() > 0 ? axis.normalized() : Vec3(Vec3::Zero());
+      for (uint32_t t : candidates) {
+        if (emitted[t]) continue;
+        size_t n = fresh(t);
+        float dot = direction.dot(normals[t]);
+        if (n < bestFresh || (n == bestFresh && dot > bestDot)) {
+          best = t;
+          bestFresh = n;
+          bestDot = dot;
+        }
+      }
+
+      if (best >= 0 && (vertices.size() + bestFresh > maxVertices || (written - begin) / 3 >= maxTriangles)) {
+        // the full meshlet is done and best seeds the next one next to it
+        finish();
+      }
+      if (best < 0) {
+        if (written > begin) finish();
+        while (emitted[cursor]) cursor++;
+        best = int64_t(cursor);
+        candidates.clear();
+      }
+      if (written == begin) candidates.clear();
+
+      uint32_t id = uint32_t(meshlets.size());
+      emitted[best] = 1;
+      axis += normals[best];
+      for (int k = 0; k < 3; k++) {
+        Index v = indices[best * 3 + k];
+        out[written++] = v;
+        if (owner[v] == id) continue;
+        owner[v] = id;
+        vertices.push_back(uint32_t(v));
+        for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++)
+          if (!emitted[adjacency[a]]) candidates.push_back(adjacency[a]);
+      }
+      // drop emitted candidates now and then so the list stays short
+      if (candidates.size() > 4 * maxVertices)
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t t) { return emitted[t]; }),
+          candidates.end());
+    }
+    if (written > begin) finish();
+    return meshlets;
+  }
+
+  // Reorders the triangles inside every meshlet for the vertex cache, which
+  // buildMeshlets() trades for grouping. The triangle sets stay the same, so
+  // do the bounds and cones. The vertices of a meshlet are numbered locally
+  // for optimizeCache(), so each call costs the size of its meshlet instead
+  // of the mesh. indices is the buffer the meshlets' firstIndex refers to.
+  template <typename Index>
+  inline void optimizeMeshlets(const Meshlet* meshlets, size_t count, Index* indices, size_t cacheSize = 16) {
+    std::vector<uint32_t> local, reordered, global;
+    for (size_t m = 0; m < count; m++) {
+      Index* list = indices + meshlets[m].firstIndex;
+      uint32_t n = meshlets[m].indexCount;
+      local.resize(n);
+      reordered.resize(n);
+      global.clear();
+      for (uint32_t i = 0; i < n; i++) {
+        auto at = std::find(global.begin(), global.end(), uint32_t(list[i]));
+        local[i] = uint32_t(at - global.begin());
+        if (at == global.end()) global.push_back(uint32_t(list[i]));
+      }
+      optimizeCache(local.data(), n, global.size(), reordered.data(), cacheSize);
+      for (uint32_t i = 0; i < n; i++) list[i] = Index(global[reordered[i]]);
+    }
+  }
+
+  // The six planes of a clip matrix with WebGPU depth in [0, 1], normalized
+  // and in the space the matrix maps from.
+  struct Frustum {
+    Eigen::Vector4f planes[6];
+
+    static Frustum fromMatrix(const Eigen::Matrix4f& m) {
+      Frustum f;
+      Eigen::Vector4f x = m.row(0), y = m.row(1), z = m.row(2), w = m.row(3);
+      f.planes[0] = w + x;
+      f.planes[1] = w - x;
+      f.planes[2] = w + y;
+      f.planes[3] = w - y;
+      f.planes[4] = z;
+      f.planes[5] = w - z;
+      for (auto& p : f.planes) p /= p.head<3>().norm();
+      return f;
+    }
+
+    bool intersects(const float* center, float radius) const {
+      Eigen::Vector4f c(center[0], center[1], center[2], 1);
+      for (auto& p : planes)
+        if (p.dot(c) < -radius) return false;
+      return true;
+    }
+  };
+
+  // True if every triangle of the meshlet faces away from eye: the sphere
+  // seen from eye has to lie within the angle the normal cone leaves on the
+  // back side.
+  inline bool backfacing(const Meshlet& m, const Eigen::Vector3f& eye) {
+    if (m.coneAngle >= float(M_PI_2)) return false;
+    Eigen::Vector3f view = Eigen::Map<const Eigen::Vector3f>(m.center) - eye;
+    float distance = view.norm();
+    if (distance <= m.radius) return false;
+    float cosine = std::clamp(view.dot(Eigen::Map<const Eigen::Vector3f>(m.coneAxis)) / distance, -1.f, 1.f);
+    return std::acos(cosine) + std::asin(m.radius / distance) + m.coneAngle < float(M_PI_2);
+  }
+
+  // Culls meshlets outside the frustum or facing away from eye, both in the
+  // space of the positions, and hands the rest to onRange(firstIndex,
+  // indexCount), merging meshlets that follow each other in the index
+  // buffer. Returns the number of visible meshlets.
+  template <typename OnRange>
+  inline size_t cullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const Eigen::Vector3f& eye,
+    OnRange&& onRange)
+  {
+    size_t visible = 0;
+    uint32_t first = 0, indexCount = 0;
+    for (size_t i = 0; i < count; i++) {
+      const Meshlet& m = meshlets[i];
+      if (!frustum.intersects(m.center, m.radius) || backfacing(m, eye)) continue;
+      visible++;
+      if (indexCount && first + indexCount == m.firstIndex) {
+        indexCount += m.indexCount;
+        continue;
+      }
+      if (indexCount) onRange(first, indexCount);
+      first = m.firstIndex;
+      indexCount = m.indexCount;
+    }
+    if (indexCount) onRange(first, indexCount);
+    return visible;
+  }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+#include "parallel.hpp"
+
+// Smooth vertex normals from positions and triangles.
+namespace mesh {
+  enum class NormalWeight { Area, Angle };
+
+  // Writes the unit normal of every vertex, the average of the normals of
+  // its triangles weighted by their area or by the angle of their corner at
+  // the vertex. Vertices without triangles get a zero normal.
+  //
+  // Face normals are computed 8 triangles at a time in Eigen packets, which
+  // vectorize on SSE/AVX and NEON alike. Vertices then gather the faces
+  // around them through a vertex -> corner adjacency, so every vertex is
+  // written by one thread and no atomics are needed. Both passes run on up
+  // to `threads` threads (0 = all cores).
+  template <typename Index>
+  inline void computeNormals(const Index* indices, size_t count, const float* positions, size_t vertexCount,
+    float* normals, NormalWeight weight = NormalWeight::Area, unsigned threads = 0)
+  {
+    using Packet = Eigen::Array<float, 8, 1>;
+    size_t triangles = count / 3;
+    bool angle = weight == NormalWeight::Angle;
+
+    // face normals, unit length for angle weights and 2x the area otherwise,
+    // and the corner angles
+    std::vector<float> faces(triangles * 3), angles(angle ? triangles * 3 : 0);
+    parallel::forChunks(triangles, std::max<size_t>(1, triangles / 65536), [&](size_t, size_t begin, size_t end) {
+      Packet p[3][3];
+      for (size_t f = begin; f < end; f += 8) {
+        size_t n = std::min<size_t>(8, end - f);
+        for (size_t i = 0; i < 8; i++)
+          for (int k = 0; k < 3; k++) {
+            const float* v = positions + size_t(indices[(f + std::min(i, n - 1)) * 3 + k]) * 3;
+            p[k][0][i] = v[0];
+            p[k][1][i] = v[1];
+            p[k][2][i] = v[2];
+          }
+        Packet e1[3], e2[3], nx, ny, nz;
+        for (int c = 0; c < 3; c++) {
+          e1[c] = p[1][c] - p[0][c];
+          e2[c] = p[2][c] - p[0][c];
+        }
+        nx = e1[1] * e2[2] - e1[2] * e2[1];
+        ny = e1[2] * e2[0] - e1[0] * e2[2];
+        nz = e1[0] * e2[1] - e1[1] * e2[0];
+
+        Packet corner[3];
+        if (angle) {
+          Packet length = (nx * nx + ny * ny + nz * nz).sqrt();
+          Packet inverse = (length > 0).select(length.inverse(), Packet::Zero());
+          nx *= inverse;
+          ny *= inverse;
+          nz *= inverse;
+          for (int k = 0; k < 3; k++) {
+            const Packet* a = p[k], * b = p[(k + 1) % 3], * c = p[(k + 2) % 3];
+            Packet u[3], w[3];
+            for (int j = 0; j < 3; j++) {
+              u[j] = b[j] - a[j];
+              w[j] = c[j] - a[j];
+            }
+            Packet dot = u[0] * w[0] + u[1] * w[1] + u[2] * w[2];
+            Packet lengths = ((u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) * (w[0] * w[0] + w[1] * w[1] + w[2] * w[2])).sqrt();
+            corner[k] = (lengths > 0).select(dot / lengths, Packet::Ones()).max(-1.f).min(1.f).acos();
+          }
+        }
+        for (size_t i = 0; i < n; i++) {
+          float* out = &faces[(f + i) * 3];
+          out[0] = nx[i];
+          out[1] = ny[i];
+          out[2] = nz[i];
+          if (angle)
+            for (int k = 0; k < 3; k++) angles[(f + i) * 3 + k] = corner[k][i];
+        }
+      }
+      }, threads);
+
+    // vertex -> corner adjacency
+    std::vector<uint32_t> offsets(vertexCount + 1, 0), corners(triangles * 3);
+    for (size_t i = 0; i < triangles * 3; i++) offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < triangles * 3; i++) corners[fill[indices[i]]++] = uint32_t(i);
+    }
+
+    parallel::forRange(vertexCount, [&](size_t begin, size_t end) {
+      for (size_t v = begin; v < end; v++) {
+        Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+        for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++) {
+          uint32_t c = corners[a];
+          Eigen::Map<const Eigen::Vector3f> n(&faces[c / 3 * 3]);
+          sum += n * (angle ? angles[c] : 1.f);
+        }
+        float length = sum.norm();
+        Eigen::Map<Eigen::Vector3f>(normals + v * 3) = length > 0 ? Eigen::Vector3f(sum / length) : Eigen::Vector3f::Zero();
+      }
+      }, threads);
+  }
+}
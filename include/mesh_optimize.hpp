@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+// Triangle and vertex reordering for the post-transform vertex cache, for
+// overdraw and for vertex fetch locality, after Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007).
+namespace mesh {
+  // Post-transform cache efficiency of a triangle list under a FIFO cache.
+  // acmr is transformed vertices per triangle (0.5 is ideal for large grids,
+  // 3 the worst), atvr transformed vertices per referenced vertex (1 is ideal).
+  struct CacheStats {
+    float acmr;
+    float atvr;
+  };
+
+  template <typename Index>
+  inline CacheStats analyzeCache(const Index* indices, size_t count, size_t vertexCount, size_t cacheSize = 16) {
+    std::vector<uint64_t> time(vertexCount, 0);
+    std::vector<char> used(vertexCount, 0);
+    uint64_t now = cacheSize + 1, misses = 0, unique = 0;
+    for (size_t i = 0; i < count; i++) {
+      Index v = indices[i];
+      unique += !used[v];
+      used[v] = 1;
+      if (now - time[v] > cacheSize) {
+        time[v] = now++;
+        misses++;
+      }
+    }
+    size_t triangles = count / 3;
+    return { triangles ? float(misses) / triangles : 0.f, unique ? float(misses) / unique : 0.f };
+  }
+
+  // Tipsify: reorders triangles so consecutive ones share vertices still in
+  // a cache of cacheSize entries. Writes the new triangle order to out and
+  // returns the first triangle of every cluster that starts at a dead end,
+  // where the order jumps to an unrelated part of the mesh.
+  template <typename Index>
+  inline std::vector<uint32_t> optimizeCache(
+    const Index* indices, size_t count, size_t vertexCount, Index* out, size_t cacheSize = 16)
+  {
+    size_t triangles = count / 3;
+    // vertex -> triangles adjacency
+    std::vector<uint32_t> offsets(vertexCount + 1, 0), adjacency(triangles * 3), live(vertexCount, 0);
+    for (size_t i = 0; i < triangles * 3; i++) live[indices[i]]++;
+    std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangles * 3; i++) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+
+    std::vector<uint64_t> time(vertexCount, 0);
+    std::vector<char> emitted(triangles, 0);
+    std::vector<uint32_t> deadEnd, candidates, clusters;
+    uint64_t now = cacheSize + 1;
+    size_t written = 0, cursor = 0;
+
+    auto next = [&]() -> int64_t {
+      int64_t best = -1, bestPriority = -1;
+      for (uint32_t v : candidates) {
+        if (!live[v]) continue;
+        // prefer the oldest cached vertex whose remaining fan still fits the cache
+        int64_t age = int64_t(now - time[v]), priority = 0;
+        if (age + 2 * int64_t(live[v]) <= int64_t(cacheSize)) priority = age;
+        if (priority > bestPriority) {
+          best = v;
+          bestPriority = priority;
+        }
+      }
+      if (best >= 0) return best;
+
+      clusters.push_back(uint32_t(written / 3));
+      while (!deadEnd.empty()) {
+        uint32_t v = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[v]) return v;
+      }
+      for (; cursor < vertexCount; cursor++)
+        if (live[cursor]) return int64_t(cursor++);
+      return -1;
+    };
+
+    for (int64_t f = triangles ? next() : -1; f >= 0; f = next()) {
+      candidates.clear();
+      for (uint32_t k = offsets[f]; k < offsets[f + 1]; k++) {
+        uint32_t t = adjacency[k];
+        if (emitted[t]) continue;
+        emitted[t] = 1;
+        for (int j = 0; j < 3; j++) {
+          Index v = indices[t * 3 + j];
+          out[written++] = v;
+          deadEnd.push_back(v);
+          candidates.push_back(v);
+          live[v]--;
+          if (now - time[v] > cacheSize) time[v] = now++;
+        }
+      }
+    }
+    // the first call to next() always opens a cluster at triangle 0
+    if (!clusters.empty() && clusters.back() == triangles) clusters.pop_back();
+    return clusters;
+  }
+
+  // Reorders the clusters of an optimizeCache() result so triangles facing
+  // away from the mesh center, which tend to occlude the rest, draw first.
+  // Clusters are first split wherever the cache ACMR within the cluster is
+  // at most threshold times that of the whole mesh, which bounds the cache
+  // cost of the new order.
+  template <typename Index>
+  inline void optimizeOverdraw(
+    const Index* indices, size_t count, const float* positions, size_t vertexCount,
+    const std::vector<uint32_t>& clusters, Index* out, float threshold = 1.05f, size_t cacheSize = 16)
+  {
+    using Vec3 = Eigen::Vector3f;
+    size_t triangles = count / 3;
+    if (!triangles) return;
+    float acmr = analyzeCache(indices, count, vertexCount, cacheSize).acmr;
+
+    // soft boundaries inside each hard cluster
+    std::vector<uint32_t> starts;
+    std::vector<uint64_t> time(vertexCount, 0);
+    uint64_t now = cacheSize + 1;
+    for (size_t c = 0; c <= clusters.size(); c++) {
+      size_t begin = c ? clusters[c - 1] : 0, end = c < clusters.size() ? clusters[c] : triangles;
+      if (begin >= end) continue;
+      starts.push_back(uint32_t(begin));
+      now += cacheSize + 1; // a cold cache at every cluster start
+      uint64_t misses = 0, start = begin;
+      for (size_t t = begin; t < end; t++) {
+        for (int j = 0; j < 3; j++) {
+          Index v = indices[t * 3 + j];
+          if (now - time[v] > cacheSize) {
+            time[v] = now++;
+            misses++;
+          }
+        }
+        if (t + 1 < end && float(misses) / float(t + 1 - start) <= threshold * acmr) {
+          starts.push_back(uint32_t(t + 1));
+          now += cacheSize + 1;
+          misses = 0;
+          start = t + 1;
+        }
+      }
+    }
+    starts.push_back(uint32_t(triangles));
+
+    auto vertex = [&](Index v) { return Eigen::Map<const Vec3>(positions + size_t(v) * 3); };
+    Vec3 center = Vec3::Zero();
+    for (size_t v = 0; v < vertexCount; v++) center += vertex(Index(v));
+    center /= float(std::max<size_t>(vertexCount, 1));
+
+    size_t n = starts.size() - 1;
+    std::vector<float> key(n);
+    for (size_t c = 0; c < n; c++) {
+      Vec3 centroid = Vec3::Zero(), normal = Vec3::Zero();
+      float area = 0;
+      for (size_t t = starts[c]; t < starts[c + 1]; t++) {
+        Vec3 a = vertex(indices[t * 3]), b = vertex(indices[t * 3 + 1]), d = vertex(indices[t * 3 + 2]);
+        Vec3 cross = (b - a).cross(d - a);
+        float w = cross.norm();
+        centroid += (a + b + d) * (w / 3);
+        normal += cross;
+        area += w;
+      }
+      if (area > 0) centroid /= area;
+      key[c] = (centroid - center).dot(normal.normalized());
+    }
+
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+    for (uint32_t c : order)
+      out = std::copy(indices + size_t(starts[c]) * 3, indices + size_t(starts[c + 1]) * 3, out);
+  }
+
+  // Renumbers vertices in the order the indices first reference them and
+  // rewrites the indices in place. remap receives the source vertex of every
+  // output vertex, unreferenced vertices are dropped; apply it to each
+  // attribute stream with remapStream().
+  template <typename Index>
+  inline void optimizeVertexFetch(Index* indices, size_t count, size_t vertexCount, std::vector<uint32_t>& remap) {
+    std::vector<uint32_t> renumber(vertexCount, UINT32_MAX);
+    remap.clear();
+    for (size_t i = 0; i < count; i++) {
+      uint32_t& v = renumber[indices[i]];
+      if (v == UINT32_MAX) {
+        v = uint32_t(remap.size());
+        remap.push_back(uint32_t(indices[i]));
+      }
+      indices[i] = Index(v);
+    }
+  }
+
+  // Runs optimizeCache(), optimizeOverdraw() and optimizeVertexFetch() on a
+  // triangle list in place.
+  template <typename Index>
+  inline void optimize(std::vector<Index>& indices, const float* positions, size_t vertexCount,
+    std::vector<uint32_t>& remap, float threshold = 1.05f, size_t cacheSize = 16)
+  {
+    std::vector<Index> ordered(indices.size());
+    auto clusters = optimizeCache(indices.data(), indices.size(), vertexCount, ordered.data(), cacheSize);
+    optimizeOverdraw(ordered.data(), ordered.size(), positions, vertexCount, clusters, indices.data(), threshold, cacheSize);
+    optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+  }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "mesh.hpp"
+#include "mesh_ao.hpp"
+#include "mesh_bvh.hpp"
+#include "mesh_normals.hpp"
+#include "mesh_optimize.hpp"
+#include "mesh_weld.hpp"
+#include "parallel.hpp"
+
+// Mesh preprocessing as a sequence of passes over the streams of a mesh in
+// memory.
+namespace mesh {
+  // Streams of MeshData, as masks of what a pass reads and writes.
+  enum Stream : uint32_t {
+    Positions = 1,
+    Colors = 2,
+    Normals = 4,
+    Indices = 8,
+  };
+
+  // A triangle mesh with xyz positions, rgb colors and normals per vertex.
+  // Colors and normals are empty until something writes them.
+  struct MeshData {
+    std::vector<float> positions;
+    std::vector<float> colors;
+    std::vector<float> normals;
+    std::vector<uint32_t> indices;
+
+    size_t vertexCount() const { return positions.size() / 3; }
+
+    // the streams that hold data
+    uint32_t streams() const {
+      return (positions.empty() ? 0 : uint32_t(Positions)) | (colors.empty() ? 0 : uint32_t(Colors)) |
+        (normals.empty() ? 0 : uint32_t(Normals)) | (indices.empty() ? 0 : uint32_t(Indices));
+    }
+
+    // Applies a remap from weld(), optimize() or split16() to every vertex
+    // stream that holds data.
+    void remap(const std::vector<uint32_t>& order) {
+      for (auto* stream : { &positions, &colors, &normals }) {
+        if (stream->empty()) continue;
+        std::vector<float> out(order.size() * 3);
+        remapStream(stream->data(), 3, order, out.data());
+        stream->swap(out);
+      }
+    }
+  };
+
+  // The vertex streams of a range of vertices, nullptr where a stream is
+  // empty.
+  struct VertexChunk {
+    float* positions;
+    float* colors;
+    float* normals;
+    size_t count;
+  };
+
+  // One step of a Pipeline, which declares the streams it reads and writes.
+  // A pass either transforms the whole mesh in run, or every vertex on its
+  // own in vertex: given the statistics of the positions it will see, vertex
+  // updates them to describe the positions it writes and returns the
+  // transform of a chunk. Runs of vertex passes are fused.
+  struct Pass {
+    std::string name;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    std::function<void(MeshData&, unsigned threads)> run;
+    std::function<std::function<void(const VertexChunk&)>(Stats&)> vertex;
+  };
+
+  class Pipeline {
+  public:
+    std::vector<Pass> passes;
+
+    Pipeline& then(Pass pass) {
+      passes.push_back(std::move(pass));
+      return *this;
+    }
+
+    // Runs the passes in order on up to `threads` threads (0 = all cores)
+    // and calls onPass(name, seconds) after each, with the names of fused
+    // passes joined by '+'. Every run of vertex passes costs two passes
+    // over the vertices: one parallel reduction of the position statistics
+    // they all derive their parameters from, and one parallel pass that
+    // applies all of them to a chunk while it is in cache. Fails, before
+    // running anything, if a pass reads a stream that is empty at that
+    // point.
+    bool run(MeshData& data, unsigned threads = 0,
+      const std::function<void(const std::string&, double)>& onPass = nullptr) const
+    {
+      uint32_t available = data.streams();
+      for (const Pass& pass : passes) {
+        if (pass.reads & ~available) {
+          printf("Error: pass %s reads a stream nothing wrote\n", pass.name.c_str());
+          return false;
+        }
+        available |= pass.writes;
+      }
+
+      for (size_t i = 0; i < passes.size();) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::string name = passes[i].name;
+        if (!passes[i].vertex) passes[i++].run(data, threads);
+        else {
+          size_t count = data.vertexCount();
+          Stats stats = statsOf(data.positions.data(), count, threads);
+          std::vector<std::function<void(const VertexChunk&)>> fns;
+          for (size_t first = i; i < passes.size() && passes[i].vertex; i++) {
+            if (i > first) name += "+" + passes[i].name;
+            if (passes[i].writes & Colors) data.colors.resize(count * 3);
+            if (passes[i].writes & Normals) data.normals.resize(count * 3);
+            fns.push_back(passes[i].vertex(stats));
+          }
+          parallel::forChunks(count, std::max<size_t>(1, count / 65536), [&](size_t, size_t begin, size_t end) {
+            auto at = [&](std::vector<float>& stream) { return stream.empty() ? nullptr : stream.data() + begin * 3; };
+            VertexChunk chunk{ at(data.positions), at(data.colors), at(data.normals), end - begin };
+            for (auto& fn : fns) fn(chunk);
+            }, threads);
+        }
+        if (onPass) onPass(name, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+      }
+      return true;
+    }
+  };
+
+  // The passes the apps compose their preprocessing from.
+  namespace passes {
+    // Centers the positions on their mean and divides them by the largest
+    // coordinate, in place per chunk; later vertex passes in the same run
+    // see the stats of the result
+    inline Pass normalize() {
+      return { "normalize", Positions, Positions, nullptr, [](Stats& stats) {
+        Eigen::Array3f mean = stats.mean().array(), scale = Eigen::Array3f::Constant(1 / stats.scale());
+        stats = stats.normalized();
+        return [=](const VertexChunk& chunk) {
+          scaleOffset(chunk.positions, chunk.count, mean, scale, chunk.positions);
+          };
+        } };
+    }
+
+    // Writes colors from the positions mapped into [0, 1] per axis of their
+    // bounding box, for meshes that come without colors
+    inline Pass colorFromBounds() {
+      return { "colorFromBounds", Positions, Colors, nullptr, [](Stats& stats) {
+        Eigen::RowVector3f lo = stats.lo, hi = stats.hi;
+        return [=](const VertexChunk& chunk) {
+          mesh::colorFromBounds(chunk.positions, chunk.count, lo, hi, chunk.colors);
+          };
+        } };
+    }
+
+    // weld(), reporting the vertex counts to stats if given
+    inline Pass weld(float epsilon, WeldStats* stats = nullptr) {
+      return { "weld", Positions | Indices, Positions | Colors | Normals | Indices, [=](MeshData& data, unsigned threads) {
+        std::vector<uint32_t> remap;
+        WeldStats result = mesh::weld(data.indices.data(), data.indices.size(), data.positions.data(), data.vertexCount(),
+          epsilon, remap, threads);
+        if (stats) *stats = result;
+        if (result.after < result.before) data.remap(remap);
+        }, nullptr };
+    }
+
+    // optimize() for the vertex cache, overdraw and vertex fetch
+    inline Pass optimize() {
+      return { "optimize", Positions | Indices, Positions | Colors | Normals | Indices, [](MeshData& data, unsigned) {
+        std::vector<uint32_t> order;
+        mesh::optimize(data.indices, data.positions.data(), data.vertexCount(), order);
+        data.remap(order);
+        }, nullptr };
+    }
+
+    // Writes a normal per vertex from the faces around it in the indices,
+    // weighted by weight; vertices without triangles get a zero normal
+    inline Pass normals(NormalWeight weight = NormalWeight::Angle) {
+      return { "normals", Positions | Indices, Normals, [=](MeshData& data, unsigned threads) {
+        data.normals.resize(data.positions.size());
+        computeNormals(data.indices.data(), data.indices.size(), data.positions.data(), data.vertexCount(),
+          data.normals.data(), weight, threads);
+        }, nullptr };
+    }
+
+    // bakeOcclusion() against the mesh itself, multiplied into the colors
+    inline Pass occlusion(unsigned samples = 32, float distance = .1f) {
+      return { "occlusion", Positions | Colors | Normals | Indices, Colors, [=](MeshData& data, unsigned threads) {
+        size_t count = data.vertexCount();
+        Bvh bvh(data.indices.data(), data.indices.size(), data.positions.data(), threads);
+        std::vector<float> visibility(count);
+        bakeOcclusion(bvh, data.positions.data(), data.normals.data(), count, visibility.data(), samples, distance, threads);
+        for (size_t i = 0; i < count * 3; i++) data.colors[i] *= visibility[i / 3];
+        }, nullptr };
+    }
+  }
+}
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include "mesh.hpp"
+
+// Simplification by half-edge collapses ordered by quadric error, after
+// Garland and Heckbert, "Surface Simplification Using Quadric Error
+// Metrics" (1997). Every collapse moves a vertex onto a neighbor instead of
+// a new position, so all levels of detail index the original vertices and
+// can share one vertex buffer.
+namespace mesh {
+  // Sum of area-weighted squared distances to a set of planes, as the upper
+  // triangle of a symmetric 4x4 matrix.
+  struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+    double weight = 0;
+
+    // the plane n . p + d = 0 with a unit normal n
+    static Quadric plane(const Eigen::Vector3d& n, double d, double weight) {
+      Quadric q;
+      q.xx = n.x() * n.x() * weight; q.xy = n.x() * n.y() * weight; q.xz = n.x() * n.z() * weight; q.xw = n.x() * d * weight;
+      q.yy = n.y() * n.y() * weight; q.yz = n.y() * n.z() * weight; q.yw = n.y() * d * weight;
+      q.zz = n.z() * n.z() * weight; q.zw = n.z() * d * weight;
+      q.ww = d * d * weight;
+      q.weight = weight;
+      return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+      xx += o.xx; xy += o.xy; xz += o.xz; xw += o.xw; yy += o.yy; yz += o.yz; yw += o.yw;
+      zz += o.zz; zw += o.zw; ww += o.ww;
+      weight += o.weight;
+      return *this;
+    }
+
+    Quadric operator+(const Quadric& o) const { return Quadric(*this) += o; }
+
+    // mean squared distance of p to the planes
+    double error(const float* p) const {
+      double x = p[0], y = p[1], z = p[2];
+      double e = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+        + yy * y * y + 2 * yz * y * z + 2 * yw * y
+        + zz * z * z + 2 * zw * z + ww;
+      return weight > 0 ? std::max(e, 0.) / weight : 0;
+    }
+  };
+
+  // Per-vertex attributes that a collapse should keep, such as colors,
+  // count floats per vertex. Their error is weight times the squared
+  // difference to the linear interpolation over the original triangles, so
+  // collapses that smear a color edge cost even if every vertex keeps its
+  // own color (Hoppe, "New Quadric Metric for Simplifying Meshes with
+  // Appearance Attributes", 1999).
+  struct Attributes {
+    const float* data = nullptr;
+    size_t stride = 0;
+    size_t count = 0;
+    float weight = 0;
+  };
+
+  // Area-weighted sums over the triangles around a vertex of
+  // (g . p + d - s)^2 per attribute, where g and d describe the attribute
+  // as a linear function over each triangle. Laid out as the shared
+  // p-quadric gg (6), gd (3), dd and area, then g and d per attribute.
+  struct AttributeQuadrics {
+    size_t count;
+    size_t stride;
+    std::vector<double> data;
+
+    AttributeQuadrics(size_t vertexCount, size_t count) : count(count), stride(11 + 4 * count), data(count ? vertexCount * stride : 0, 0.) {}
+
+    double* operator[](size_t v) { return data.data() + v * stride; }
+
+    void add(size_t v, const double* g, const double* d, double area) {
+      double* q = (*this)[v];
+      for (size_t c = 0; c < count; c++) {
+        const double* gc = g + c * 3;
+        q[0] += area * gc[0] * gc[0]; q[1] += area * gc[0] * gc[1]; q[2] += area * gc[0] * gc[2];
+        q[3] += area * gc[1] * gc[1]; q[4] += area * gc[1] * gc[2]; q[5] += area * gc[2] * gc[2];
+        for (int k = 0; k < 3; k++) q[6 + k] += area * gc[k] * d[c];
+        q[9] += area * d[c] * d[c];
+        double* a = q + 11 + c * 4;
+        for (int k = 0; k < 3; k++) a[k] += area * gc[k];
+        a[3] += area * d[c];
+      }
+      q[10] += area;
+    }
+
+    void merge(size_t to, size_t from) {
+      double *a = (*this)[to], *b = (*this)[from];
+      for (size_t i = 0; i < stride; i++) a[i] += b[i];
+    }
+
+    // mean squared attribute error of the merged quadrics of from and to,
+    // evaluated at position p with the attributes s
+    double error(size_t from, size_t to, const float* p, const float* s) {
+      double q[64], *a = (*this)[from], *b = (*this)[to];
+      for (size_t i = 0; i < stride; i++) q[i] = a[i] + b[i];
+      double x = p[0], y = p[1], z = p[2];
+      double e = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + q[3] * y * y + 2 * q[4] * y * z + q[5] * z * z
+        + 2 * (q[6] * x + q[7] * y + q[8] * z) + q[9];
+      for (size_t c = 0; c < count; c++) {
+        const double* g = q + 11 + c * 4;
+        e += s[c] * s[c] * q[10] - 2 * s[c] * (g[0] * x + g[1] * y + g[2] * z + g[3]);
+      }
+      return q[10] > 0 ? std::max(e, 0.) / q[10] : 0;
+    }
+  };
+
+  // Collapses edges of a triangle list in order of increasing error until it
+  // has at most targets.back() triangles or no collapse is left. Each time
+  // the live triangles drop to the next of the decreasing targets,
+  // onLevel(indices, indexCount, error) receives them with the largest error
+  // of a collapse so far. Collapses that flip a triangle are rejected and
+  // border edges are kept in place by planes perpendicular to them.
+  template <typename Index, typename OnLevel>
+  inline void collapse(const Index* indices, size_t count, const float* positions, size_t vertexCount,
+    const std::vector<size_t>& targets, const Attributes& attributes, OnLevel&& onLevel)
+  {
+    using Vec3 = Eigen::Vector3d;
+    auto point = [&](uint32_t v) { return Eigen::Map<const Eigen::Vector3f>(positions + size_t(v) * 3).cast<double>(); };
+
+    size_t triangleCount = count / 3, live = triangleCount;
+    std::vector<uint32_t> tris(indices, indices + triangleCount * 3);
+    std::vector<char> dead(triangleCount, 0), removed(vertexCount, 0);
+    std::vector<std::vector<uint32_t>> adjacency(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++)
+      for (int k = 0; k < 3; k++) adjacency[tris[t * 3 + k]].push_back(uint32_t(t));
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+      Vec3 a = point(tris[t * 3]), b = point(tris[t * 3 + 1]), c = point(tris[t * 3 + 2]);
+      Vec3 n = (b - a).cross(c - a);
+      double area = n.norm() * .5;
+      if (area <= 0) continue;
+      n.normalize();
+      Quadric q = Quadric::plane(n, -n.dot(a), area);
+      for (int k = 0; k < 3; k++) quadrics[tris[t * 3 + k]] += q;
+    }
+
+    // every edge keyed by its endpoints, sorted so shared ones are adjacent
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++)
+      for (int k = 0; k < 3; k++) {
+        uint64_t a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+        edges.push_back({ std::min(a, b) << 32 | std::max(a, b), uint32_t(t * 3 + k) });
+      }
+    std::sort(edges.begin(), edges.end());
+
+    // an edge used by one triangle is a border
+    for (size_t i = 0; i < edges.size(); i++) {
+      bool shared = (i > 0 && edges[i - 1].first == edges[i].first) ||
+        (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+      if (shared) continue;
+      uint32_t t = edges[i].second / 3, k = edges[i].second % 3;
+      uint32_t va = tris[t * 3 + k], vb = tris[t * 3 + (k + 1) % 3], vc = tris[t * 3 + (k + 2) % 3];
+      Vec3 a = point(va), b = point(vb), c = point(vc);
+      Vec3 edge = b - a, n = edge.cross((b - a).cross(c - a));
+      double length = edge.norm();
+      if (length <= 0 || n.norm() <= 0) continue;
+      n.normalize();
+      // weighted well above the surface so borders hardly move
+      Quadric q = Quadric::plane(n, -n.dot(a), length * length * 10);
+      quadrics[va] += q;
+      quadrics[vb] += q;
+    }
+
+    // every attribute as a linear function over each triangle, up to 13 of them
+    size_t channels = attributes.data && attributes.weight > 0 ? std::min<size_t>(attributes.count, 13) : 0;
+    AttributeQuadrics attributeQuadrics(vertexCount, channels);
+    auto attribute = [&](uint32_t v) { return attributes.data + size_t(v) * attributes.stride; };
+    for (size_t t = 0; channels && t < triangleCount; t++) {
+      const uint32_t* v = &tris[t * 3];
+      Vec3 p0 = point(v[0]), e1 = point(v[1]) - p0, e2 = point(v[2]) - p0;
+      double a11 = e1.dot(e1), a12 = e1.dot(e2), a22 = e2.dot(e2), det = a11 * a22 - a12 * a12;
+      double area = e1.cross(e2).norm() * .5;
+      if (det <= 0 || area <= 0) continue;
+      double g[39], d[13];
+      for (size_t c = 0; c < channels; c++) {
+        double s0 = attribute(v[0])[c], d1 = attribute(v[1])[c] - s0, d2 = attribute(v[2])[c] - s0;
+        // the gradient in the triangle plane, g . e1 = d1 and g . e2 = d2
+        Vec3 gc = e1 * ((a22 * d1 - a12 * d2) / det) + e2 * ((a11 * d2 - a12 * d1) / det);
+        for (int k = 0; k < 3; k++) g[c * 3 + k] = gc[k];
+        d[c] = s0 - gc.dot(p0);
+      }
+      for (int k = 0; k < 3; k++) attributeQuadrics.add(v[k], g, d, area);
+    }
+    auto attributeCost = [&](uint32_t from, uint32_t to) {
+      if (!channels) return 0.;
+      return attributes.weight * attributeQuadrics.error(from, to, positions + size_t(to) * 3, attribute(to));
+    };
+
+    // candidates stay in the queue after their endpoints change and are
+    // skipped when their versions are stale
+    struct Candidate {
+      double cost;
+      uint32_t from, to;
+      uint32_t fromVersion, toVersion;
+      bool operator<(const Candidate& o) const { return cost > o.cost; }
+    };
+    std::vector<uint32_t> version(vertexCount, 0);
+    std::priority_queue<Candidate> queue;
+    auto push = [&](uint32_t from, uint32_t to) {
+      double cost = (quadrics[from] + quadrics[to]).error(positions + size_t(to) * 3) + attributeCost(from, to);
+      queue.push({ cost, from, to, version[from], version[to] });
+    };
+    // each undirected edge once, in both directions
+    for (size_t i = 0; i < edges.size(); i++) {
+      if (i > 0 && edges[i - 1].first == edges[i].first) continue;
+      uint32_t a = uint32_t(edges[i].first >> 32), b = uint32_t(edges[i].first);
+      if (a != b) push(a, b), push(b, a);
+    }
+    edges.clear();
+    edges.shrink_to_fit();
+
+    // a collapse must not turn any remaining triangle of from over
+    auto flips = [&](uint32_t from, uint32_t to) {
+      Vec3 p = point(to);
+      for (uint32_t t : adjacency[from]) {
+        if (dead[t]) continue;
+        uint32_t* v = &tris[t * 3];
+        if (v[0] == to || v[1] == to || v[2] == to) continue;
+        Vec3 a = point(v[0]), b = point(v[1]), c = point(v[2]);
+        Vec3 before = (b - a).cross(c - a);
+        (v[0] == from ? a : v[1] == from ? b : c) = p;
+        Vec3 after = (b - a).cross(c - a);
+        if (after.dot(before) <= 0) return true;
+      }
+      return false;
+    };
+
+    std::vector<uint32_t> compact, neighbors;
+    auto emit = [&](double error) {
+      compact.clear();
+      for (size_t t = 0; t < triangleCount; t++)
+        if (!dead[t]) compact.insert(compact.end(), &tris[t * 3], &tris[t * 3 + 3]);
+      onLevel(compact.data(), compact.size(), float(std::sqrt(error)));
+    };
+
+    double maxCost = 0;
+    size_t level = 0;
+    while (level < targets.size()) {
+      if (live <= targets[level]) {
+        emit(maxCost);
+        level++;
+        continue;
+      }
+      if (queue.empty()) break;
+      Candidate c = queue.top();
+      queue.pop();
+      if (removed[c.from] || removed[c.to] || version[c.from] != c.fromVersion || version[c.to] != c.toVersion) continue;
+      if (flips(c.from, c.to)) continue;
+
+      for (uint32_t t : adjacency[c.from]) {
+        if (dead[t]) continue;
+        uint32_t* v = &tris[t * 3];
+        if (v[0] == c.to || v[1] == c.to || v[2] == c.to) {
+          dead[t] = 1;
+          live--;
+          continue;
+        }
+        for (int k = 0; k < 3; k++) if (v[k] == c.from) v[k] = c.to;
+        adjacency[c.to].push_back(t);
+      }
+      adjacency[c.from].clear();
+      adjacency[c.from].shrink_to_fit();
+      removed[c.from] = 1;
+      quadrics[c.to] += quadrics[c.from];
+      if (channels) attributeQuadrics.merge(c.to, c.from);
+      version[c.to]++;
+      maxCost = std::max(maxCost, c.cost);
+
+      // drop dead triangles and requeue every edge of the merged vertex
+      auto& around = adjacency[c.to];
+      around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return dead[t]; }), around.end());
+      neighbors.clear();
+      for (uint32_t t : around)
+        for (int k = 0; k < 3; k++)
+          if (tris[t * 3 + k] != c.to) neighbors.push_back(tris[t * 3 + k]);
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+      for (uint32_t n : neighbors) push(c.to, n), push(n, c.to);
+    }
+    // out of collapses: the remaining levels are as coarse as it gets
+    if (level < targets.size()) emit(maxCost);
+  }
+
+  // Simplifies a triangle list to at most targetCount indices, or as close
+  // as collapses allow, and returns the error.
+  template <typename Index>
+  inline float simplify(const Index* indices, size_t count, const float* positions, size_t vertexCount,
+    size_t targetCount, std::vector<Index>& out, const Attributes& attributes = {})
+  {
+    float error = 0;
+    out.clear();
+    collapse(indices, count, positions, vertexCount, { targetCount / 3 }, attributes,
+      [&](const uint32_t* level, size_t n, float e) {
+        out.assign(level, level + n);
+        error = e;
+      });
+    return error;
+  }
+
+  // Appends a chain of levels of detail to a triangle list, each with about
+  // ratio times the triangles of the previous one, down to minTriangles or
+  // maxLevels levels. Returns the levels starting with the full mesh; a
+  // level that could not get any coarser ends the chain.
+  template <typename Index>
+  inline std::vector<Lod> buildLods(std::vector<Index>& indices, const float* positions, size_t vertexCount,
+    const Attributes& attributes = {}, float ratio = .5f, size_t minTriangles = 256, size_t maxLevels = 8)
+  {
+    std::vector<Lod> lods{ { 0, uint32_t(indices.size()), 0 } };
+    std::vector<size_t> targets;
+    for (size_t n = size_t((indices.size() / 3) * ratio); n >= minTriangles && targets.size() + 1 < maxLevels; n = size_t(n * ratio))
+      targets.push_back(n);
+    if (targets.empty()) return lods;
+
+    size_t count = indices.size();
+    std::vector<Index> source(indices.begin(), indices.end());
+    collapse(source.data(), count, positions, vertexCount, targets, attributes,
+      [&](const uint32_t* level, size_t n, float error) {
+        if (n >= lods.back().indexCount) return;
+        lods.push_back({ uint32_t(indices.size()), uint32_t(n), error });
+        indices.insert(indices.end(), level, level + n);
+      });
+    return lods;
+  }
+
+  // The coarsest level whose error stays within threshold pixels, given how
+  // many pixels one position unit covers on screen.
+  inline size_t selectLod(const Lod* lods, size_t count, float pixelsPerUnit, float threshold = 1) {
+    size_t level = 0;
+    for (size_t i = 1; i < count; i++)
+      if (lods[i].error * pixelsPerUnit <= threshold) level = i;
+    return level;
+  }
+}
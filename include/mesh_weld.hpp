@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "parallel.hpp"
+
+// Merges duplicated vertices, such as the copies exporters leave along
+// seams or one per face corner.
+namespace mesh {
+  // Vertex counts before and after weld().
+  struct WeldStats {
+    size_t before;
+    size_t after;
+  };
+
+  // Merges every vertex into the lowest indexed vertex within epsilon of
+  // it, which follows that vertex if it was merged in turn. This is not a
+  // transitive closure: two vertices within epsilon of each other stay apart
+  // when the higher one has a lower neighbor out of reach of the other one.
+  // epsilon = 0 merges only bitwise equal positions, hashing the bits
+  // instead of grid cells. Indices are rewritten in place and numbered in
+  // the order the kept vertices appear in the source; remap receives the
+  // source vertex of every output vertex for remapStream().
+  //
+  // Vertices are bucketed by a spatial hash of cells 2 * epsilon wide, so
+  // every neighbor within epsilon is in one of the 8 cells nearest to a
+  // vertex. The lookups run in parallel on up to `threads` threads
+  // (0 = all cores).
+  template <typename Index>
+  inline WeldStats weld(Index* indices, size_t count, const float* positions, size_t vertexCount, float epsilon,
+    std::vector<uint32_t>& remap, unsigned threads = 0)
+  {
+    size_t buckets = std::bit_ceil(std::max<size_t>(vertexCount, 1));
+    float cellSize = 2 * epsilon;
+    auto mix = [](uint64_t h) {
+      h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+      h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+      return h ^ (h >> 31);
+    };
+    auto cell = [&](const float* p, int k) { return int64_t(std::floor(p[k] / cellSize)); };
+    auto cellHash = [&](int64_t x, int64_t y, int64_t z) {
+      return mix(uint64_t(x) * 73856093u ^ uint64_t(y) * 19349663u ^ uint64_t(z) * 83492791u) & (buckets - 1);
+    };
+    auto bitsHash = [&](const float* p) {
+      uint32_t b[3];
+      std::memcpy(b, p, sizeof(b));
+      return mix((uint64_t(b[0]) | uint64_t(b[1]) << 32) ^ uint64_t(b[2]) * 0x9e3779b97f4a7c15ull) & (buckets - 1);
+    };
+
+    // bucket of every vertex, then the vertices of every bucket in index order
+    std::vector<uint32_t> bucket(vertexCount), offsets(buckets + 1, 0), sorted(vertexCount);
+    parallel::forRange(vertexCount, [&](size_t begin, size_t end) {
+      for (size_t v = begin; v < end; v++) {
+        const float* p = positions + v * 3;
+        bucket[v] = uint32_t(epsilon > 0 ? cellHash(cell(p, 0), cell(p, 1), cell(p, 2)) : bitsHash(p));
+      }
+      }, threads);
+    for (size_t v = 0; v < vertexCount; v++) offsets[bucket[v] + 1]++;
+    for (size_t b = 0; b < buckets; b++) offsets[b + 1] += offsets[b];
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t v = 0; v < vertexCount; v++) sorted[fill[bucket[v]]++] = uint32_t(v);
+    }
+
+    // the lowest vertex index within epsilon, never above the vertex itself
+    std::vector<uint32_t> target(vertexCount);
+    float epsilon2 = epsilon * epsilon;
+    parallel::forRange(vertexCount, [&](size_t begin, size_t end) {
+      for (size_t v = begin; v < end; v++) {
+        const float* p = positions + v * 3;
+        uint32_t best = uint32_t(v);
+        auto search = [&](size_t b) {
+          for (uint32_t i = offsets[b]; i < offsets[b + 1] && sorted[i] < best; i++) {
+            const float* q = positions + size_t(sorted[i]) * 3;
+            if (epsilon > 0) {
+              float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+              if (dx * dx + dy * dy + dz * dz <= epsilon2) best = sorted[i];
+            }
+            else if (std::memcmp(p, q, 3 * sizeof(float)) == 0) best = sorted[i];
+          }
+        };
+        if (epsilon > 0) {
+          // the cell of p and its neighbors toward the nearer side on every axis
+          int64_t c[3], d[3];
+          for (int k = 0; k < 3; k++) {
+            c[k] = cell(p, k);
+            d[k] = p[k] / cellSize - float(c[k]) < .5f ? -1 : 1;
+          }
+          for (int n = 0; n < 8; n++)
+            search(cellHash(c[0] + (n & 1 ? d[0] : 0), c[1] + (n & 2 ? d[1] : 0), c[2] + (n & 4 ? d[2] : 0)));
+        }
+        else search(bucket[v]);
+        target[v] = best;
+      }
+      }, threads);
+
+    // targets only point down, so one pass in index order resolves chains
+    std::vector<uint32_t> renumber(vertexCount);
+    remap.clear();
+    for (size_t v = 0; v < vertexCount; v++) {
+      if (target[v] == v) {
+        renumber[v] = uint32_t(remap.size());
+        remap.push_back(uint32_t(v));
+      }
+      else renumber[v] = renumber[target[v]];
+    }
+
+    parallel::forRange(count, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) indices[i] = Index(renumber[indices[i]]);
+      }, threads);
+    return { vertexCount, remap.size() };
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+  inline unsigned threadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+  }
+
+  // Splits [0, n) into `chunks` contiguous ranges and calls fn(chunk, begin, end)
+  // for each of them on up to `threads` threads (0 = all cores). Chunks are
+  // handed out round-robin so a thread always processes the same chunks.
+  template <typename Fn>
+  inline void forChunks(size_t n, size_t chunks, Fn&& fn, unsigned threads = 0) {
+    if (n == 0 || chunks == 0) return;
+    chunks = std::min(chunks, n);
+    threads = std::min<size_t>(threads ? threads : threadCount(), chunks);
+
+    auto run = [&](unsigned t) {
+      for (size_t c = t; c < chunks; c += threads)
+        fn(c, n * c / chunks, n * (c + 1) / chunks);
+      };
+    if (threads == 1) return run(0);
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; t++) workers.emplace_back(run, t);
+    run(0);
+    for (auto& w : workers) w.join();
+  }
+
+  // Calls fn(begin, end) over contiguous ranges of [0, n), one per thread.
+  template <typename Fn>
+  inline void forRange(size_t n, Fn&& fn, unsigned threads = 0) {
+    threads = threads ? threads : threadCount();
+    forChunks(n, threads, [&](size_t, size_t begin, size_t end) { fn(begin, end); }, threads);
+  }
+}
@@ -1,63 +1,433 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <utility>
 #include <vector>
 
+// Procedural primitives. Every shape is a description with a generator
+// that runs in constant expressions, so a fixed tessellation can be baked
+// into std::arrays at compile time with generateStatic() and uploaded
+// straight from read-only data, while generate() runs the same code at
+// runtime into std::vectors for tessellations picked on the fly.
 namespace prim {
-  void gnomon(std::vector<float>& V, float s = 1.) {
-    V.resize(36);
-    V.assign({
-      0, 0, 0, 1, 0, 0,
-      s, 0, 0, 1, 0, 0, // x
-      0, 0, 0, 0, 1, 0,
-      0, s, 0, 0, 1, 0, // y
-      0, 0, 0, 0, 0, 1,
-      0, 0, s, 0, 0, 1, // z
-      });
-  };
-
-  void cube(std::vector<float>& V, std::vector<uint16_t>& F, float s = 1.) {
-    V.resize(144);
-    V.assign({
-      s, s, -s, 1, 0, 0,
-      s, s, s, 1, 0, 0,
-      s, -s, s, 1, 0, 0,
-      s, -s, -s, 1, 0, 0,
-      -s, s, s, -1, 0, 0,
-      -s, s, -s, -1, 0, 0,
-      -s, -s, -s, -1, 0, 0,
-      -s, -s, s, -1, 0, 0,
-      -s, s, s, 0, 1, 0,
-      s, s, s, 0, 1, 0,
-      s, s, -s, 0, 1, 0,
-      -s, s, -s, 0, 1, 0,
-      -s, -s, -s, 0, -1, 0,
-      s, -s, -s, 0, -1, 0,
-      s, -s, s, 0, -1, 0,
-      -s, -s, s, 0, -1, 0,
-      s, s, s, 0, 0, 1,
-      -s, s, s, 0, 0, 1,
-      -s, -s, s, 0, 0, 1,
-      s, -s, s, 0, 0, 1,
-      -s, s, -s, 0, 0, -1,
-      s, s, -s, 0, 0, -1,
-      s, -s, -s, 0, 0, -1,
-      -s, -s, -s, 0, 0, -1,
-      });
-
-    F.resize(36);
-    F.assign({
-      0, 1, 2,
-      0, 2, 3,
-      4, 5, 6,
-      4, 6, 7,
-      8, 9, 10,
-      8, 10, 11,
-      12, 13, 14,
-      12, 14, 15,
-      16, 17, 18,
-      16, 18, 19,
-      20, 21, 22,
-      20, 22, 23
-      });
+  // Everything a generator knows about a vertex. Vertex layouts copy the
+  // fields they have.
+  struct Vertex {
+    std::array<float, 3> position{};
+    std::array<float, 3> normal{};
+    std::array<float, 2> uv{};
+    std::array<float, 3> color{ 1, 1, 1 };
   };
+
+  // Vertex layouts, interleaved floats ready to upload. Any struct with
+  // some of the float arrays position[3], normal[3], uv[2] and color[3]
+  // works as a layout.
+  struct Position { float position[3]; };
+  struct PositionNormal { float position[3]; float normal[3]; };
+  struct PositionNormalUv { float position[3]; float normal[3]; float uv[2]; };
+  struct PositionColor { float position[3]; float color[3]; };
+
+  namespace detail {
+    constexpr double pi = 3.14159265358979323846;
+
+    // sin and cos, exact at multiples of pi / 2: reduced to [-pi/4, pi/4]
+    // around the nearest of them and expanded as Taylor series, which is
+    // far below float precision there
+    constexpr void sincos(double x, double& s, double& c) {
+      double q = x / (pi / 2);
+      long long n = (long long)(q + (q < 0 ? -.5 : .5));
+      double r = x - double(n) * (pi / 2), r2 = r * r;
+      double sr = r * (1 - r2 / 6 * (1 - r2 / 20 * (1 - r2 / 42 * (1 - r2 / 72 * (1 - r2 / 110 * (1 - r2 / 156 * (1 - r2 / 210)))))));
+      double cr = 1 - r2 / 2 * (1 - r2 / 12 * (1 - r2 / 30 * (1 - r2 / 56 * (1 - r2 / 90 * (1 - r2 / 132 * (1 - r2 / 182))))));
+      switch (n & 3) {
+      case 0: s = sr; c = cr; break;
+      case 1: s = cr; c = -sr; break;
+      case 2: s = -sr; c = -cr; break;
+      default: s = -cr; c = sr; break;
+      }
+    }
+
+    constexpr double sqrt(double x) {
+      if (!(x > 0)) return 0;
+      double r = x > 1 ? x : 1, next = (r + x / r) / 2;
+      while (next < r) {
+        r = next;
+        next = (r + x / r) / 2;
+      }
+      return r;
+    }
+
+    template <typename Layout>
+    constexpr Layout layout(const Vertex& v) {
+      Layout out{};
+      if constexpr (requires { out.position; }) for (int k = 0; k < 3; k++) out.position[k] = v.position[k];
+      if constexpr (requires { out.normal; }) for (int k = 0; k < 3; k++) out.normal[k] = v.normal[k];
+      if constexpr (requires { out.uv; }) for (int k = 0; k < 2; k++) out.uv[k] = v.uv[k];
+      if constexpr (requires { out.color; }) for (int k = 0; k < 3; k++) out.color[k] = v.color[k];
+      return out;
+    }
+
+    // where generators write to, arrays or vectors of the right size
+    template <typename Layout, typename Index, typename Vertices, typename Indices>
+    struct Sink {
+      Vertices& vertices;
+      Indices& indices;
+      size_t vertexCount = 0;
+      size_t indexCount = 0;
+
+      constexpr void vertex(const Vertex& v) { vertices[vertexCount++] = layout<Layout>(v); }
+
+      constexpr void triangle(uint32_t a, uint32_t b, uint32_t c) {
+        indices[indexCount++] = Index(a);
+        indices[indexCount++] = Index(b);
+        indices[indexCount++] = Index(c);
+      }
+
+      // two triangles of the quad a b c d, counter-clockwise
+      constexpr void quad(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        triangle(a, b, c);
+        triangle(a, c, d);
+      }
+    };
+  }
+
+  // The three axes as a line list of unit colors: x red, y green, z blue.
+  struct Gnomon {
+    float size = 1;
+
+    constexpr size_t vertexCount() const { return 6; }
+    constexpr size_t indexCount() const { return 0; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      for (int axis = 0; axis < 3; axis++)
+        for (int end = 0; end < 2; end++) {
+          Vertex v;
+          v.position[axis] = end * size;
+          v.color = { 0, 0, 0 };
+          v.color[axis] = 1;
+          out.vertex(v);
+        }
+    }
+  };
+
+  // A cube spanning [-size, size] with a quad of 4 vertices per face, so
+  // every face has its own normal and uvs.
+  struct Cube {
+    float size = 1;
+
+    constexpr size_t vertexCount() const { return 24; }
+    constexpr size_t indexCount() const { return 36; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      // faces in the order +x -x +y -y +z -z, each spanned by the two other
+      // axes in the order that winds counter-clockwise from outside
+      constexpr float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+      for (uint32_t f = 0; f < 6; f++) {
+        int n = f / 2, u = (n + 1) % 3, w = (n + 2) % 3;
+        float sign = f % 2 ? -1.f : 1.f;
+        if (sign < 0) std::swap(u, w);
+        for (auto& corner : corners) {
+          Vertex v;
+          v.normal[n] = sign;
+          v.position[n] = sign * size;
+          v.position[u] = corner[0] * size;
+          v.position[w] = corner[1] * size;
+          v.uv = { corner[0] * .5f + .5f, corner[1] * -.5f + .5f };
+          out.vertex(v);
+        }
+        out.quad(f * 4, f * 4 + 1, f * 4 + 2, f * 4 + 3);
+      }
+    }
+  };
+
+  // A latitude/longitude sphere around the y axis, with a seam of repeated
+  // vertices at u = 0 and 1, and a vertex per segment at the poles so every
+  // pole triangle has its own u.
+  struct UvSphere {
+    float radius = 1;
+    uint32_t segments = 32;
+    uint32_t rings = 16;
+
+    constexpr size_t vertexCount() const { return size_t(segments + 1) * (rings - 1) + segments * 2; }
+    constexpr size_t indexCount() const { return size_t(segments) * (rings - 1) * 6; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      for (uint32_t r = 0; r <= rings; r++) {
+        bool pole = r == 0 || r == rings;
+        double st, ct;
+        detail::sincos(detail::pi * r / rings, st, ct);
+        for (uint32_t s = 0; s < segments + !pole; s++) {
+          double u = (s + (pole ? .5 : 0)) / segments, sp, cp;
+          detail::sincos(2 * detail::pi * u, sp, cp);
+          Vertex v;
+          v.normal = { float(st * cp), float(ct), float(-st * sp) };
+          for (int k = 0; k < 3; k++) v.position[k] = v.normal[k] * radius;
+          v.uv = { float(u), float(r) / rings };
+          out.vertex(v);
+        }
+      }
+      // ring r > 0 starts after the pole and r - 1 full rings
+      auto ring = [&](uint32_t r) { return r ? segments + (r - 1) * (segments + 1) : 0; };
+      for (uint32_t r = 0; r < rings; r++)
+        for (uint32_t s = 0; s < segments; s++) {
+          uint32_t a = ring(r) + s, b = ring(r + 1) + s;
+          if (r > 0) out.triangle(a, b, a + 1);
+          if (r + 1 < rings) out.triangle(r > 0 ? a + 1 : a, b, b + 1);
+        }
+    }
+  };
+
+  // A geodesic sphere: an icosahedron with every edge split into
+  // `frequency` parts, projected on the sphere. Vertices are shared between
+  // faces, 10 f^2 + 2 of them for 20 f^2 triangles, and have no uvs.
+  struct IcoSphere {
+    float radius = 1;
+    uint32_t frequency = 4;
+
+    constexpr size_t vertexCount() const { return size_t(frequency) * frequency * 10 + 2; }
+    constexpr size_t indexCount() const { return size_t(frequency) * frequency * 60; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      constexpr double t = 1.6180339887498948482;
+      constexpr double corners[12][3] = {
+        { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+        { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+        { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 },
+      };
+      constexpr uint32_t faces[20][3] = {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 },
+      };
+      // the 30 edges in the order faces first use them, from the lower
+      // corner to the higher one
+      uint32_t edges[30][2] = {};
+      uint32_t edgeCount = 0;
+      auto edge = [&](uint32_t a, uint32_t b) {
+        uint32_t lo = a < b ? a : b, hi = a < b ? b : a;
+        for (uint32_t e = 0; e < edgeCount; e++)
+          if (edges[e][0] == lo && edges[e][1] == hi) return e;
+        edges[edgeCount][0] = lo;
+        edges[edgeCount][1] = hi;
+        return edgeCount++;
+      };
+      for (auto& face : faces)
+        for (int k = 0; k < 3; k++) edge(face[k], face[(k + 1) % 3]);
+
+      uint32_t f = frequency;
+      auto emit = [&](const double* a, const double* b, const double* c, double i, double j) {
+        double p[3], length = 0;
+        for (int k = 0; k < 3; k++) {
+          p[k] = a[k] + (b[k] - a[k]) * i / f + (c[k] - a[k]) * j / f;
+          length += p[k] * p[k];
+        }
+        length = detail::sqrt(length);
+        Vertex v;
+        for (int k = 0; k < 3; k++) {
+          v.normal[k] = float(p[k] / length);
+          v.position[k] = float(p[k] / length * radius);
+        }
+        out.vertex(v);
+      };
+
+      // corners, then the inner vertices of the edges, then those of the faces
+      for (auto& corner : corners) emit(corner, corner, corner, 0, 0);
+      for (uint32_t e = 0; e < 30; e++)
+        for (uint32_t k = 1; k < f; k++) emit(corners[edges[e][0]], corners[edges[e][1]], corners[edges[e][0]], k, 0);
+      uint32_t inner = (f - 1) * (f - 2) / 2, firstInner = 12 + 30 * (f - 1);
+      for (auto& face : faces)
+        for (uint32_t j = 1; j < f; j++)
+          for (uint32_t i = 1; i + j < f; i++) emit(corners[face[0]], corners[face[1]], corners[face[2]], i, j);
+
+      // the vertex at a + i/f (b - a) + j/f (c - a) of a face
+      for (uint32_t n = 0; n < 20; n++) {
+        const uint32_t* face = faces[n];
+        auto at = [&](uint32_t i, uint32_t j) -> uint32_t {
+          if (i == 0 && j == 0) return face[0];
+          if (i == f) return face[1];
+          if (j == f) return face[2];
+          uint32_t from = face[0], to = face[1], k = i;
+          if (i == 0) { to = face[2]; k = j; }
+          else if (i + j == f) { from = face[1]; to = face[2]; k = j; }
+          else if (j != 0) {
+            // row j holds f - j - 1 inner vertices
+            uint32_t row = (j - 1) * (2 * f - j - 2) / 2;
+            return firstInner + n * inner + row + i - 1;
+          }
+          uint32_t e = edge(from, to);
+          return 12 + e * (f - 1) + (from < to ? k : f - k) - 1;
+        };
+        for (uint32_t j = 0; j < f; j++)
+          for (uint32_t i = 0; i + j < f; i++) {
+            out.triangle(at(i, j), at(i + 1, j), at(i, j + 1));
+            if (i + j + 1 < f) out.triangle(at(i + 1, j), at(i + 1, j + 1), at(i, j + 1));
+          }
+      }
+    }
+  };
+
+  // A cylinder along the y axis from -height / 2 to height / 2, with flat
+  // caps unless caps is false.
+  struct Cylinder {
+    float radius = 1;
+    float height = 2;
+    uint32_t segments = 32;
+    bool caps = true;
+
+    constexpr size_t vertexCount() const { return size_t(segments + 1) * (caps ? 4 : 2); }
+    constexpr size_t indexCount() const { return size_t(segments) * (caps ? 12 : 6); }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      float half = height / 2;
+      for (uint32_t s = 0; s <= segments; s++) {
+        double sp, cp;
+        detail::sincos(2 * detail::pi * s / segments, sp, cp);
+        for (int end = 0; end < 2; end++) {
+          Vertex v;
+          v.normal = { float(cp), 0, float(-sp) };
+          v.position = { float(cp * radius), end ? half : -half, float(-sp * radius) };
+          v.uv = { float(s) / segments, end ? 0.f : 1.f };
+          out.vertex(v);
+        }
+      }
+      for (uint32_t s = 0; s < segments; s++) out.quad(s * 2, s * 2 + 2, s * 2 + 3, s * 2 + 1);
+      if (!caps) return;
+
+      // a center and a rim per cap
+      for (int end = 0; end < 2; end++) {
+        uint32_t center = (segments + 1) * (end + 2);
+        float y = end ? half : -half, sign = end ? 1.f : -1.f;
+        Vertex v;
+        v.normal = { 0, sign, 0 };
+        v.position = { 0, y, 0 };
+        v.uv = { .5f, .5f };
+        out.vertex(v);
+        for (uint32_t s = 0; s < segments; s++) {
+          double sp, cp;
+          detail::sincos(2 * detail::pi * s / segments, sp, cp);
+          v.position = { float(cp * radius), y, float(-sp * radius) };
+          v.uv = { float(cp) * .5f + .5f, float(sp * sign) * .5f + .5f };
+          out.vertex(v);
+          uint32_t a = center + 1 + s, b = center + 1 + (s + 1) % segments;
+          if (end) out.triangle(center, a, b);
+          else out.triangle(center, b, a);
+        }
+      }
+    }
+  };
+
+  // A torus around the y axis: a tube of radius `tube` along a circle of
+  // `radius` in the xz plane.
+  struct Torus {
+    float radius = 1;
+    float tube = .25f;
+    uint32_t segments = 48;
+    uint32_t sides = 16;
+
+    constexpr size_t vertexCount() const { return size_t(segments + 1) * (sides + 1); }
+    constexpr size_t indexCount() const { return size_t(segments) * sides * 6; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      for (uint32_t s = 0; s <= segments; s++) {
+        double st, ct;
+        detail::sincos(2 * detail::pi * s / segments, st, ct);
+        for (uint32_t j = 0; j <= sides; j++) {
+          double sp, cp;
+          detail::sincos(2 * detail::pi * j / sides, sp, cp);
+          Vertex v;
+          v.normal = { float(cp * ct), float(sp), float(-cp * st) };
+          v.position = { float((radius + tube * cp) * ct), float(tube * sp), float(-(radius + tube * cp) * st) };
+          v.uv = { float(s) / segments, float(j) / sides };
+          out.vertex(v);
+        }
+      }
+      for (uint32_t s = 0; s < segments; s++)
+        for (uint32_t j = 0; j < sides; j++) {
+          uint32_t a = s * (sides + 1) + j, b = a + sides + 1;
+          out.quad(a, b, b + 1, a + 1);
+        }
+    }
+  };
+
+  // A square in the xz plane spanning [-size, size], facing +y, split into
+  // divisions x divisions quads.
+  struct Grid {
+    float size = 1;
+    uint32_t divisions = 10;
+
+    constexpr size_t vertexCount() const { return size_t(divisions + 1) * (divisions + 1); }
+    constexpr size_t indexCount() const { return size_t(divisions) * divisions * 6; }
+
+    template <typename Out>
+    constexpr void generate(Out& out) const {
+      for (uint32_t j = 0; j <= divisions; j++)
+        for (uint32_t i = 0; i <= divisions; i++) {
+          Vertex v;
+          v.uv = { float(i) / divisions, float(j) / divisions };
+          v.position = { (v.uv[0] * 2 - 1) * size, 0, (v.uv[1] * 2 - 1) * size };
+          v.normal = { 0, 1, 0 };
+          out.vertex(v);
+        }
+      for (uint32_t j = 0; j < divisions; j++)
+        for (uint32_t i = 0; i < divisions; i++) {
+          uint32_t a = j * (divisions + 1) + i, b = a + divisions + 1;
+          out.quad(a, b, b + 1, a + 1);
+        }
+    }
+  };
+
+  // Triangle lists, or a line list without indices for the gnomon.
+  template <typename Layout, typename Index>
+  struct Mesh {
+    std::vector<Layout> vertices;
+    std::vector<Index> indices;
+  };
+
+  template <typename Layout, typename Index, size_t VertexCount, size_t IndexCount>
+  struct StaticMesh {
+    std::array<Layout, VertexCount> vertices;
+    std::array<Index, IndexCount> indices;
+  };
+
+  // Generates shape at runtime. Fails with an empty mesh if its vertices
+  // do not fit in Index.
+  template <typename Layout = PositionNormal, typename Index = uint16_t, typename Shape>
+  inline Mesh<Layout, Index> generate(const Shape& shape) {
+    Mesh<Layout, Index> mesh;
+    if (shape.vertexCount() > size_t(std::numeric_limits<Index>::max()) + 1) {
+      printf("Error: %zu vertices do not fit in %zu-byte indices\n", shape.vertexCount(), sizeof(Index));
+      return mesh;
+    }
+    mesh.vertices.resize(shape.vertexCount());
+    mesh.indices.resize(shape.indexCount());
+    detail::Sink<Layout, Index, std::vector<Layout>, std::vector<Index>> sink{ mesh.vertices, mesh.indices };
+    shape.generate(sink);
+    return mesh;
+  }
+
+  // Generates the shape `make` returns into arrays, in a constant
+  // expression when the result is constexpr:
+  //
+  //   static constexpr auto cube = prim::generateStatic([] { return prim::Cube{ .size = .5f }; });
+  //
+  // The shape comes from a lambda because its counts size the arrays.
+  template <typename Layout = PositionNormal, typename Index = uint16_t, typename Make>
+  constexpr auto generateStatic(Make make) {
+    constexpr auto shape = make();
+    static_assert(shape.vertexCount() <= size_t(std::numeric_limits<Index>::max()) + 1, "vertices do not fit in Index");
+    StaticMesh<Layout, Index, shape.vertexCount(), shape.indexCount()> mesh{};
+    detail::Sink<Layout, Index, decltype(mesh.vertices), decltype(mesh.indices)> sink{ mesh.vertices, mesh.indices };
+    shape.generate(sink);
+    return mesh;
+  }
 }
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Compact vertex encodings that the GPU expands in the vertex fetch:
+// positions as Snorm16x4 relative to the mesh bounds, unit normals
+// octahedron-encoded as Snorm16x2 and colors as Unorm8x4. wgsl() returns
+// the matching decode functions.
+namespace quantize {
+  // An attribute stream, element i starts at data + i * stride.
+  template <typename T>
+  struct Stream {
+    T* data;
+    size_t stride;
+
+    T* operator[](size_t i) const { return data + i * stride; }
+  };
+
+  // Affine map from the snorm range [-1, 1] to the bounds, per axis.
+  struct Bounds {
+    float center[3];
+    float scale[3];
+
+    static Bounds fromBox(const float* lo, const float* hi) {
+      Bounds b;
+      for (int k = 0; k < 3; k++) {
+        b.center[k] = (lo[k] + hi[k]) * .5f;
+        b.scale[k] = std::max((hi[k] - lo[k]) * .5f, 1e-20f);
+      }
+      return b;
+    }
+  };
+
+  inline int16_t snorm16(float v) { return int16_t(std::lround(std::clamp(v, -1.f, 1.f) * 32767.f)); }
+  inline float fromSnorm16(int16_t v) { return std::max(v / 32767.f, -1.f); }
+  inline uint8_t unorm8(float v) { return uint8_t(std::lround(std::clamp(v, 0.f, 1.f) * 255.f)); }
+
+  // xyz relative to the bounds, w = 1
+  inline void encodePositions(Stream<const float> in, size_t count, const Bounds& b, Stream<int16_t> out) {
+    for (size_t i = 0; i < count; i++) {
+      for (int k = 0; k < 3; k++) out[i][k] = snorm16((in[i][k] - b.center[k]) / b.scale[k]);
+      out[i][3] = 32767;
+    }
+  }
+
+  inline void decodePosition(const int16_t* q, const Bounds& b, float* out) {
+    for (int k = 0; k < 3; k++) out[k] = fromSnorm16(q[k]) * b.scale[k] + b.center[k];
+  }
+
+  // Projects the unit sphere onto an octahedron and unfolds it to a square.
+  inline void encodeNormals(Stream<const float> in, size_t count, Stream<int16_t> out) {
+    for (size_t i = 0; i < count; i++) {
+      const float* n = in[i];
+      float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+      float x = l1 > 0 ? n[0] / l1 : 0, y = l1 > 0 ? n[1] / l1 : 0;
+      if (n[2] < 0) {
+        float fx = (1 - std::abs(y)) * (x >= 0 ? 1 : -1), fy = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+        x = fx;
+        y = fy;
+      }
+      out[i][0] = snorm16(x);
+      out[i][1] = snorm16(y);
+    }
+  }
+
+  inline void decodeNormal(const int16_t* q, float* out) {
+    float x = fromSnorm16(q[0]), y = fromSnorm16(q[1]), z = 1 - std::abs(x) - std::abs(y);
+    float t = std::max(-z, 0.f);
+    x += x >= 0 ? -t : t;
+    y += y >= 0 ? -t : t;
+    float l = std::sqrt(x * x + y * y + z * z);
+    out[0] = x / l;
+    out[1] = y / l;
+    out[2] = z / l;
+  }
+
+  // rgb in [0, 1], a = 1
+  inline void encodeColors(Stream<const float> in, size_t count, Stream<uint8_t> out) {
+    for (size_t i = 0; i < count; i++) {
+      for (int k = 0; k < 3; k++) out[i][k] = unorm8(in[i][k]);
+      out[i][3] = 255;
+    }
+  }
+
+  inline void decodeColor(const uint8_t* q, float* out) {
+    for (int k = 0; k < 3; k++) out[k] = q[k] / 255.f;
+  }
+
+  // Largest and root mean square distance between original and decoded
+  // values, in the attribute's units (angles in degrees for normals).
+  struct Error {
+    double max = 0;
+    double rms = 0;
+    size_t count = 0;
+
+    // combines the errors of two sets of values
+    Error& operator+=(const Error& other) {
+      size_t n = count + other.count;
+      if (n) rms = std::sqrt((rms * rms * count + other.rms * other.rms * other.count) / n);
+      max = std::max(max, other.max);
+      count = n;
+      return *this;
+    }
+  };
+
+  template <typename Q, typename Distance>
+  inline Error measure(Stream<const float> in, Stream<const Q> q, size_t count, Distance&& distance) {
+    Error e;
+    e.count = count;
+    for (size_t i = 0; i < count; i++) {
+      double d = distance(in[i], q[i]);
+      e.max = std::max(e.max, d);
+      e.rms += d * d;
+    }
+    e.rms = count ? std::sqrt(e.rms / count) : 0;
+    return e;
+  }
+
+  inline Error positionError(Stream<const float> in, Stream<const int16_t> q, size_t count, const Bounds& b) {
+    return measure(in, q, count, [&](const float* p, const int16_t* e) {
+      float d[3];
+      decodePosition(e, b, d);
+      return std::sqrt(double(d[0] - p[0]) * (d[0] - p[0]) + double(d[1] - p[1]) * (d[1] - p[1]) + double(d[2] - p[2]) * (d[2] - p[2]));
+      });
+  }
+
+  inline Error normalError(Stream<const float> in, Stream<const int16_t> q, size_t count) {
+    return measure(in, q, count, [&](const float* n, const int16_t* e) {
+      float d[3];
+      decodeNormal(e, d);
+      // atan2 stays accurate for the tiny angles acos would lose to rounding
+      double cx = double(n[1]) * d[2] - double(n[2]) * d[1];
+      double cy = double(n[2]) * d[0] - double(n[0]) * d[2];
+      double cz = double(n[0]) * d[1] - double(n[1]) * d[0];
+      double dot = double(n[0]) * d[0] + double(n[1]) * d[1] + double(n[2]) * d[2];
+      return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180 / M_PI;
+      });
+  }
+
+  inline Error colorError(Stream<const float> in, Stream<const uint8_t> q, size_t count) {
+    return measure(in, q, count, [&](const float* c, const uint8_t* e) {
+      float d[3];
+      decodeColor(e, d);
+      double m = 0;
+      for (int k = 0; k < 3; k++) m = std::max(m, double(std::abs(d[k] - std::clamp(c[k], 0.f, 1.f))));
+      return m;
+      });
+  }
+
+  // WGSL decode functions for vertex inputs declared as vec4f (positions)
+  // and vec2f (normals); Unorm8x4 colors arrive decoded.
+  inline std::string wgsl(const Bounds& b) {
+    char constants[256];
+    snprintf(constants, sizeof(constants),
+      "const quantizedCenter = vec3f(%.9g, %.9g, %.9g);\n"
+      "const quantizedScale = vec3f(%.9g, %.9g, %.9g);\n",
+      b.center[0], b.center[1], b.center[2], b.scale[0], b.scale[1], b.scale[2]);
+    return std::string(constants) + R"(
+  fn decodePosition(q: vec4f) -> vec3f {
+    return q.xyz * quantizedScale + quantizedCenter;
+  }
+
+  fn decodeNormal(e: vec2f) -> vec3f {
+    var n = vec3f(e, 1. - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.);
+    n.x += select(t, -t, n.x >= 0.);
+    n.y += select(t, -t, n.y >= 0.);
+    return normalize(n);
+  }
+)";
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "scan.hpp"
+
+namespace obj {
+  // Parses the vertex reference that starts a `v`, `v/vt` or `v/vt/vn` face
+  // token into a 0-based index. Negative references count back from the
+  // last vertex read so far. Returns the end of the token or nullptr.
+  inline const char* parseIndex(const char* p, const char* end, size_t vertexCount, int64_t& index) {
+    if (!(p = scan::parseInt(p, end, index)) || index == 0) return nullptr;
+    index = index < 0 ? int64_t(vertexCount) + index : index - 1;
+    if (index < 0 || size_t(index) >= vertexCount) return nullptr;
+    return scan::skipToken(p, end);
+  }
+}
+
+// Reads positions and faces of an OBJ file into V with x y z per vertex and
+// F with three vertex indices per triangle, as readOFF does for triangle
+// meshes. Polygons are split into fans around their first corner and faces
+// with fewer than three corners are dropped. Texture coordinates, normals,
+// groups and materials are skipped.
+template <typename Scalar, typename Index>
+inline bool readOBJ(
+  const std::string file_name,
+  std::vector<Scalar>& V,
+  std::vector<Index>& F)
+{
+  V.clear();
+  F.clear();
+
+  MappedFile file(file_name);
+  if (!file) {
+    printf("readOBJ() failed, cannot map %s\n", file_name.c_str());
+    return false;
+  }
+
+  const char* end = file.end();
+  size_t line = 1;
+  std::vector<Index> face;
+  for (const char* p = file.begin(); p < end; p = scan::skipLine(p, end), line++) {
+    p = scan::skipBlank(p, end);
+    if (end - p < 2 || !scan::isBlank(p[1])) continue;
+
+    if (p[0] == 'v') {
+      p++;
+      for (int k = 0; k < 3; k++) {
+        Scalar v;
+        if (!(p = scan::parseFloat(scan::skipBlank(p, end), end, v))) break;
+        V.push_back(v);
+      }
+    }
+    else if (p[0] == 'f') {
+      p = scan::skipBlank(p + 1, end);
+      face.clear();
+      while (p && p < end && !scan::isSpace(*p)) {
+        int64_t index;
+        if ((p = obj::parseIndex(p, end, V.size() / 3, index))) {
+          face.push_back(static_cast<Index>(index));
+          p = scan::skipBlank(p, end);
+        }
+      }
+      for (size_t k = 2; p && k < face.size(); k++) {
+        F.push_back(face[0]);
+        F.push_back(face[k - 1]);
+        F.push_back(face[k]);
+      }
+    }
+    else continue;
+
+    if (!p) {
+      printf("Error: bad line (%zu)\n", line);
+      V.clear();
+      F.clear();
+      return false;
+    }
+  }
+  return true;
+}
@@ -1,6 +1,18 @@
+#pragma once
+
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 #include <iostream>
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "scan.hpp"
 
 template <typename Scalar, typename Index>
 inline bool readOFF(
@@ -93,4 +105,481 @@ inline bool readOFF(
 
   fclose(file);
   return true;
+}
+
+namespace off {
+  struct Header {
+    int numVertices;
+    int numFaces;
+    int numEdges;
+    // per-vertex columns announced by the magic, in file order after x y z
+    bool hasNormals = false;
+    bool hasColors = false;
+  };
+
+  // Parses the [ST][C][N]OFF magic and the counts line, returns the start of
+  // the vertex section or nullptr on error.
+  inline const char* parseHeader(const char* p, const char* end, Header& header) {
+    p = scan::skipSpace(p, end);
+    const char* token = p;
+    p = scan::skipToken(p, end);
+    std::string_view magic(token, p - token);
+    size_t prefix = magic.find("OFF");
+    if (prefix == std::string_view::npos || magic.substr(0, prefix).find_first_not_of("STCN") != std::string_view::npos) {
+      printf("Error: readOFF() first line should be OFF or NOFF or COFF, not %.*s...", int(magic.size()), magic.data());
+      return nullptr;
+    }
+    header.hasNormals = magic.substr(0, prefix).find('N') != std::string_view::npos;
+    header.hasColors = magic.substr(0, prefix).find('C') != std::string_view::npos;
+
+    p = scan::skipSpace(p, end);
+    while (p < end && *p == '#') p = scan::skipSpace(scan::skipLine(p, end), end);
+
+    header.numEdges = 0;
+    if (!(p = scan::parseInt(p, end, header.numVertices)) ||
+      !(p = scan::parseInt(scan::skipBlank(p, end), end, header.numFaces))) {
+      printf("readOFF() failed, invalid counts\n");
+      return nullptr;
+    }
+    scan::parseInt(scan::skipBlank(p, end), end, header.numEdges);
+    return scan::skipLine(p, end);
+  }
+
+  // true for lines that carry no data: blank lines and `#` comments
+  inline bool isSkippable(const char* p, const char* end) {
+    p = scan::skipBlank(p, end);
+    return p == end || *p == '\n' || *p == '#';
+  }
+
+  // Parses x y z from one vertex line, ignoring any trailing normal/color
+  // columns. Returns the start of the next line or nullptr on a bad line.
+  template <typename Scalar>
+  inline const char* parseVertex(const char* p, const char* end, Scalar* out) {
+    for (int k = 0; k < 3; k++)
+      if (!(p = scan::parseFloat(scan::skipBlank(p, end), end, out[k]))) return nullptr;
+    return scan::skipLine(p, end);
+  }
+
+  // Destination of one vertex attribute, vertex i is written to data + i * stride.
+  template <typename Scalar>
+  struct Attribute {
+    Scalar* data = nullptr;
+    size_t stride = 3;
+  };
+
+  // Where the loader writes each attribute, e.g. interleaved position/color
+  //
+  //   { .position = { buf, 6 }, .color = { buf + 3, 6 } }
+  //
+  // or split streams { .position = { P, 3 }, .color = { C, 3 } }. Attributes
+  // without a destination, or missing from the file, are not written.
+  template <typename Scalar>
+  struct VertexLayout {
+    Attribute<Scalar> position = {};
+    Attribute<Scalar> normal = {};
+    Attribute<Scalar> color = {};
+  };
+
+  // Parses vertex `row` into the layout: x y z, then nx ny nz for NOFF and
+  // r g b [a] for COFF. A color written as integers only is 0-255 as in
+  // Geomview and is rescaled to [0, 1], alpha is ignored. Returns the start
+  // of the next line or nullptr on a bad line.
+  template <typename Scalar>
+  inline const char* parseVertex(const char* p, const char* end, const Header& header,
+    const VertexLayout<Scalar>& layout, size_t row)
+  {
+    Scalar discard[3];
+    auto read = [&](const Attribute<Scalar>& attribute) {
+      Scalar* out = attribute.data ? attribute.data + row * attribute.stride : discard;
+      const char* start = p;
+      for (int k = 0; k < 3 && p; k++) p = scan::parseFloat(scan::skipBlank(p, end), end, out[k]);
+      return p ? std::find_if(start, p, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) == p : false;
+    };
+    read(layout.position);
+    if (header.hasNormals) read(layout.normal);
+    if (header.hasColors && read(layout.color) && layout.color.data)
+      for (int k = 0; k < 3; k++) layout.color.data[row * layout.color.stride + k] /= Scalar(255);
+    return p ? scan::skipLine(p, end) : nullptr;
+  }
+
+  // Parses one face line (valence followed by that many indices) and appends
+  // the indices to out. Returns the start of the next line or nullptr.
+  template <typename Index>
+  inline const char* parseFace(const char* p, const char* end, std::vector<Index>& out) {
+    int valence;
+    if (!(p = scan::parseInt(scan::skipBlank(p, end), end, valence))) return nullptr;
+    for (int j = 0; j < valence; j++) {
+      int index;
+      if (!(p = scan::parseInt(scan::skipBlank(p, end), end, index))) return nullptr;
+      out.push_back(index);
+    }
+    return scan::skipLine(p, end);
+  }
+}
+
+// Same output as readOFF, but the file is memory-mapped and scanned in place
+// and V/F are sized from the header counts up front.
+template <typename Scalar, typename Index>
+inline bool readOFFMapped(
+  const std::string file_name,
+  std::vector<Scalar>& V,
+  std::vector<Index>& F)
+{
+  V.clear();
+  F.clear();
+
+  MappedFile file(file_name);
+  if (!file) {
+    printf("readOFFMapped() failed, cannot map %s\n", file_name.c_str());
+    return false;
+  }
+
+  const char* end = file.end();
+  off::Header header;
+  const char* p = off::parseHeader(file.begin(), end, header);
+  if (!p) return false;
+
+  V.resize(size_t(header.numVertices) * 3);
+  for (int i = 0; i < header.numVertices;) {
+    if (p == end) {
+      printf("Error: bad line (%d)\n", i);
+      return false;
+    }
+    if (off::isSkippable(p, end)) {
+      p = scan::skipLine(p, end);
+      continue;
+    }
+    if (const char* next = off::parseVertex(p, end, V.data() + size_t(i) * 3)) {
+      p = next;
+      i++;
+    }
+    else {
+      printf("Error: bad line (%d)\n", i);
+      p = scan::skipLine(p, end);
+    }
+  }
+
+  // faces are token based like the fscanf loop in readOFF, so a face may span lines
+  F.resize(size_t(header.numFaces) * 3);
+  size_t k = 0;
+  for (int i = 0; i < header.numFaces;) {
+    p = scan::skipSpace(p, end);
+    if (p < end && *p == '#') {
+      p = scan::skipLine(p, end);
+      continue;
+    }
+
+    int valence;
+    if (!(p = scan::parseInt(p, end, valence))) {
+      printf("Error: bad line\n");
+      return false;
+    }
+    if (k + valence > F.size()) F.resize(std::max(F.size() * 2, k + valence));
+    for (int j = 0; j < valence; j++) {
+      int index;
+      if (!(p = scan::parseInt(scan::skipSpace(p, end), end, index))) {
+        printf("Error: bad line\n");
+        return false;
+      }
+      F[k++] = index;
+    }
+    p = scan::skipLine(p, end);
+    i++;
+  }
+  F.resize(k);
+
+  return true;
+}
+
+namespace off {
+  // Parallel row parser behind readOFFParallel and readOFFLayout. The body is
+  // split into newline-aligned chunks; a first pass counts data rows per
+  // chunk, a prefix sum over the counts gives every chunk its first row, and a
+  // second pass hands vertex rows to parseRow(p, end, header, row) and parses
+  // face rows into per-chunk buffers that are then concatenated. onHeader
+  // sizes the vertex outputs before any row is parsed.
+  template <typename Index, typename OnHeader, typename ParseRow>
+  inline bool parseParallel(
+    const std::string& file_name,
+    const char* name,
+    std::vector<Index>& F,
+    unsigned threads,
+    OnHeader&& onHeader,
+    ParseRow&& parseRow)
+  {
+    F.clear();
+
+    MappedFile file(file_name);
+    if (!file) {
+      printf("%s() failed, cannot map %s\n", name, file_name.c_str());
+      return false;
+    }
+
+    const char* end = file.end();
+    Header header;
+    const char* body = parseHeader(file.begin(), end, header);
+    if (!body) return false;
+
+    threads = threads ? threads : parallel::threadCount();
+    size_t numVertices = header.numVertices, numRows = numVertices + header.numFaces;
+    size_t length = end - body;
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(threads * 4, length >> 16));
+
+    std::vector<const char*> bounds(chunks + 1);
+    bounds[0] = body;
+    bounds[chunks] = end;
+    for (size_t c = 1; c < chunks; c++)
+      bounds[c] = std::max(bounds[c - 1], scan::skipLine(body + length * c / chunks - 1, end));
+
+    std::vector<size_t> rows(chunks + 1, 0);
+    parallel::forChunks(chunks, chunks, [&](size_t c, size_t, size_t) {
+      size_t n = 0;
+      for (const char* p = bounds[c]; p < bounds[c + 1]; p = scan::skipLine(p, end))
+        n += !isSkippable(p, end);
+      rows[c + 1] = n;
+      }, threads);
+    for (size_t c = 0; c < chunks; c++) rows[c + 1] += rows[c];
+    if (rows[chunks] < numRows) {
+      printf("Error: expected %zu rows, found %zu\n", numRows, rows[chunks]);
+      return false;
+    }
+
+    onHeader(std::as_const(header));
+    std::vector<std::vector<Index>> faces(chunks);
+    std::vector<char> failed(chunks, 0);
+    parallel::forChunks(chunks, chunks, [&](size_t c, size_t, size_t) {
+      size_t row = rows[c], last = std::min(rows[c + 1], numRows);
+      if (row >= last) return;
+      if (last > numVertices) faces[c].reserve((last - std::max(row, numVertices)) * 3);
+
+      for (const char* p = bounds[c]; row < last;) {
+        if (isSkippable(p, end)) {
+          p = scan::skipLine(p, end);
+          continue;
+        }
+        const char* next = row < numVertices ?
+          parseRow(p, end, std::as_const(header), row) :
+          parseFace(p, end, faces[c]);
+        if (!next) {
+          printf("Error: bad line (%zu)\n", row);
+          failed[c] = 1;
+          return;
+        }
+        p = next;
+        row++;
+      }
+      }, threads);
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) return false;
+
+    std::vector<size_t> offsets(chunks + 1, 0);
+    for (size_t c = 0; c < chunks; c++) offsets[c + 1] = offsets[c] + faces[c].size();
+    F.resize(offsets[chunks]);
+    parallel::forChunks(chunks, chunks, [&](size_t c, size_t, size_t) {
+      std::copy(faces[c].begin(), faces[c].end(), F.begin() + offsets[c]);
+      }, threads);
+
+    return true;
+  }
+}
+
+// Parallel variant of readOFFMapped, see off::parseParallel. Unlike readOFF,
+// every face has to be on a single line and a malformed row fails the whole
+// load instead of being skipped.
+template <typename Scalar, typename Index>
+inline bool readOFFParallel(
+  const std::string file_name,
+  std::vector<Scalar>& V,
+  std::vector<Index>& F,
+  unsigned threads = 0)
+{
+  V.clear();
+  bool ok = off::parseParallel(file_name, "readOFFParallel", F, threads,
+    [&](const off::Header& header) { V.resize(size_t(header.numVertices) * 3); },
+    [&](const char* p, const char* end, const off::Header&, size_t row) {
+      return off::parseVertex(p, end, V.data() + row * 3);
+    });
+  if (!ok) V.clear();
+  return ok;
+}
+
+// Loads positions and, for NOFF/COFF files, normals and colors in the same
+// pass straight into the buffers described by the layout that
+//
+//   off::VertexLayout<Scalar> layoutFor(const off::Header&)
+//
+// returns, so they can be handed to Buffer::write without another copy. The
+// callback allocates the buffers for header.numVertices vertices and can
+// check header.hasNormals and header.hasColors. Faces as in readOFFParallel.
+template <typename Scalar, typename Index, typename LayoutFor>
+inline bool readOFFLayout(
+  const std::string file_name,
+  LayoutFor&& layoutFor,
+  std::vector<Index>& F,
+  unsigned threads = 0)
+{
+  off::VertexLayout<Scalar> layout;
+  return off::parseParallel(file_name, "readOFFLayout", F, threads,
+    [&](const off::Header& header) { layout = layoutFor(header); },
+    [&](const char* p, const char* end, const off::Header& header, size_t row) {
+      return off::parseVertex(p, end, header, layout, row);
+    });
+}
+
+// Reads only the OFF header.
+inline bool readOFFHeader(const std::string file_name, off::Header& header) {
+  FILE* file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    printf("readOFFHeader() failed, cannot open %s\n", file_name.c_str());
+    return false;
+  }
+  std::vector<char> block(1 << 16);
+  size_t size = fread(block.data(), 1, block.size(), file);
+  fclose(file);
+  return off::parseHeader(block.data(), block.data() + size, header) != nullptr;
+}
+
+// Streams an OFF file through a fixed-size read block and hands out batches
+// of up to batchSize vertices (3 scalars each) and faces (flattened indices,
+// as in readOFF) to the callbacks:
+//
+//   bool onHeader(const off::Header&)
+//   bool onVertices(Scalar* V, size_t vertexCount)
+//   bool onFaces(const Index* F, size_t indexCount)
+//
+// A callback returning false stops the stream early. The batch memory is
+// reused, so callbacks must consume or copy it, and may modify vertices in
+// place. Faces are line based as in readOFFParallel.
+//
+// onVertices may also take the colors of the batch, parsed in the same pass:
+//
+//   bool onVertices(Scalar* V, Scalar* colors, size_t vertexCount)
+//
+// colors holds 3 scalars per vertex in [0, 1] and is nullptr unless the
+// header has colors.
+template <typename Scalar, typename Index, typename OnHeader, typename OnVertices, typename OnFaces>
+inline bool streamOFF(
+  const std::string file_name,
+  size_t batchSize,
+  OnHeader&& onHeader,
+  OnVertices&& onVertices,
+  OnFaces&& onFaces,
+  size_t blockSize = 1 << 20)
+{
+  FILE* file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    printf("streamOFF() failed, cannot open %s\n", file_name.c_str());
+    return false;
+  }
+
+  std::vector<char> block(std::max<size_t>(blockSize, 1 << 12));
+  size_t size = fread(block.data(), 1, block.size(), file);
+  bool eof = size < block.size();
+
+  off::Header header;
+  const char* p = off::parseHeader(block.data(), block.data() + size, header);
+  if (!p) {
+    fclose(file);
+    return false;
+  }
+  if (!onHeader(std::as_const(header))) {
+    fclose(file);
+    return true;
+  }
+
+  batchSize = std::max<size_t>(batchSize, 1);
+  constexpr bool withColors = std::is_invocable_v<OnVertices&, Scalar*, Scalar*, size_t>;
+  std::vector<Scalar> V, C;
+  std::vector<Index> F;
+  V.reserve(batchSize * 3);
+  F.reserve(batchSize * 3);
+  if (withColors && header.hasColors) C.reserve(batchSize * 3);
+
+  size_t row = 0, numVertices = header.numVertices, numRows = numVertices + header.numFaces;
+  bool ok = true, stop = false;
+  while (row < numRows && !stop) {
+    // only complete lines are parsed, the last one may be cut off by the block
+    const char* last = block.data() + size;
+    if (!eof)
+      while (last > p && last[-1] != '\n') last--;
+
+    while (p < last && row < numRows && !stop) {
+      if (off::isSkippable(p, last)) {
+        p = scan::skipLine(p, last);
+        continue;
+      }
+      const char* next;
+      if (row < numVertices) {
+        size_t n = V.size() / 3;
+        V.resize(V.size() + 3);
+        if constexpr (withColors) {
+          C.resize(header.hasColors ? V.size() : 0);
+          next = off::parseVertex(p, last, header, off::VertexLayout<Scalar>{
+            .position = { V.data(), 3 },
+            .color = { C.empty() ? nullptr : C.data(), 3 } }, n);
+        }
+        else next = off::parseVertex(p, last, V.data() + n * 3);
+        if (next && (V.size() == batchSize * 3 || row + 1 == numVertices)) {
+          if constexpr (withColors) stop = !onVertices(V.data(), C.empty() ? nullptr : C.data(), n + 1);
+          else stop = !onVertices(V.data(), n + 1);
+          V.clear();
+          C.clear();
+        }
+      }
+      else {
+        next = off::parseFace(p, last, F);
+        if (next && (F.size() >= batchSize * 3 || row + 1 == numRows)) {
+          stop = !onFaces(std::as_const(F).data(), F.size());
+          F.clear();
+        }
+      }
+      if (!next) {
+        printf("Error: bad line (%zu)\n", row);
+        stop = true;
+        ok = false;
+        break;
+      }
+      p = next;
+      row++;
+    }
+
+    if (row < numRows && !stop) {
+      if (eof) {
+        printf("Error: unexpected end of file after %zu rows\n", row);
+        ok = false;
+        break;
+      }
+      // move the unparsed tail to the front, growing the block for lines longer than it
+      size_t rest = block.data() + size - p;
+      std::memmove(block.data(), p, rest);
+      if (rest == block.size()) block.resize(block.size() * 2);
+      size = rest + fread(block.data() + rest, 1, block.size() - rest, file);
+      eof = size < block.size();
+      p = block.data();
+    }
+  }
+
+  fclose(file);
+  return ok;
+}
+
+// Index storage of the narrowest type that can address every vertex.
+using OFFIndices = std::variant<std::vector<uint16_t>, std::vector<uint32_t>>;
+
+inline bool fitsUint16(size_t vertexCount) { return vertexCount <= 1 << 16; }
+
+// readOFFParallel into 16-bit indices when the vertex count allows it and
+// 32-bit indices otherwise.
+template <typename Scalar>
+inline bool readOFF(
+  const std::string file_name,
+  std::vector<Scalar>& V,
+  OFFIndices& F,
+  unsigned threads = 0)
+{
+  off::Header header;
+  if (!readOFFHeader(file_name, header)) return false;
+
+  if (fitsUint16(header.numVertices))
+    return readOFFParallel(file_name, V, F.template emplace<std::vector<uint16_t>>(), threads);
+  return readOFFParallel(file_name, V, F.template emplace<std::vector<uint32_t>>(), threads);
 }
\ No newline at end of file
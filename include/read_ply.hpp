@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "mapped_file.hpp"
+#include "scan.hpp"
+
+namespace ply {
+  enum class Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+  enum class Format { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+  inline Type parseType(std::string_view name) {
+    if (name == "char" || name == "int8") return Type::Int8;
+    if (name == "uchar" || name == "uint8") return Type::UInt8;
+    if (name == "short" || name == "int16") return Type::Int16;
+    if (name == "ushort" || name == "uint16") return Type::UInt16;
+    if (name == "int" || name == "int32") return Type::Int32;
+    if (name == "uint" || name == "uint32") return Type::UInt32;
+    if (name == "float" || name == "float32") return Type::Float32;
+    if (name == "double" || name == "float64") return Type::Float64;
+    return Type::Invalid;
+  }
+
+  inline size_t sizeOf(Type type) {
+    static constexpr size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+    return sizes[int(type)];
+  }
+
+  // A scalar property, or a list if countType is valid.
+  struct Property {
+    std::string name;
+    Type type;
+    Type countType = Type::Invalid;
+  };
+
+  struct Element {
+    std::string name;
+    size_t count;
+    std::vector<Property> properties;
+
+    // bytes per binary row, 0 if a list makes it variable
+    size_t stride() const {
+      size_t n = 0;
+      for (auto& property : properties) {
+        if (property.countType != Type::Invalid) return 0;
+        n += sizeOf(property.type);
+      }
+      return n;
+    }
+
+    int find(std::string_view property) const {
+      for (size_t i = 0; i < properties.size(); i++)
+        if (properties[i].name == property) return int(i);
+      return -1;
+    }
+  };
+
+  struct Header {
+    Format format;
+    std::vector<Element> elements;
+  };
+
+  inline bool isNativeOrder(Format format) {
+    return format == (std::endian::native == std::endian::little ? Format::BinaryLittleEndian : Format::BinaryBigEndian);
+  }
+
+  // Parses the header up to end_header, returns the start of the body or
+  // nullptr on error.
+  inline const char* parseHeader(const char* p, const char* end, Header& header) {
+    auto token = [&]() {
+      p = scan::skipBlank(p, end);
+      const char* start = p;
+      p = scan::skipToken(p, end);
+      return std::string_view(start, p - start);
+    };
+
+    if (token() != "ply") {
+      printf("Error: readPLY() first line should be ply\n");
+      return nullptr;
+    }
+    header.elements.clear();
+    bool hasFormat = false;
+    for (p = scan::skipLine(p, end); p < end; p = scan::skipLine(p, end)) {
+      std::string_view keyword = token();
+      if (keyword == "format") {
+        std::string_view format = token();
+        hasFormat = true;
+        if (format == "ascii") header.format = Format::Ascii;
+        else if (format == "binary_little_endian") header.format = Format::BinaryLittleEndian;
+        else if (format == "binary_big_endian") header.format = Format::BinaryBigEndian;
+        else hasFormat = false;
+      }
+      else if (keyword == "element") {
+        std::string_view name = token();
+        size_t count;
+        if (!scan::parseInt(scan::skipBlank(p, end), end, count)) break;
+        header.elements.push_back({ std::string(name), count, {} });
+      }
+      else if (keyword == "property") {
+        if (header.elements.empty()) break;
+        Property property;
+        std::string_view type = token();
+        if (type == "list") {
+          property.countType = parseType(token());
+          type = token();
+          if (property.countType == Type::Invalid) break;
+        }
+        property.type = parseType(type);
+        property.name = token();
+        if (property.type == Type::Invalid) break;
+        header.elements.back().properties.push_back(property);
+      }
+      else if (keyword == "end_header") {
+        if (!hasFormat) break;
+        return scan::skipLine(p, end);
+      }
+      else if (keyword != "comment" && keyword != "obj_info" && !keyword.empty()) break;
+    }
+    printf("readPLY() failed, invalid header\n");
+    return nullptr;
+  }
+
+  // Converts one binary value of the given type.
+  template <typename T>
+  inline T read(const char* p, Type type, bool swap) {
+    auto load = [&]<typename U>(U) {
+      U v;
+      if (swap) {
+        char bytes[sizeof(U)];
+        std::reverse_copy(p, p + sizeof(U), bytes);
+        std::memcpy(&v, bytes, sizeof(U));
+      }
+      else std::memcpy(&v, p, sizeof(U));
+      return static_cast<T>(v);
+    };
+    switch (type) {
+    case Type::Int8: return load(int8_t());
+    case Type::UInt8: return load(uint8_t());
+    case Type::Int16: return load(int16_t());
+    case Type::UInt16: return load(uint16_t());
+    case Type::Int32: return load(int32_t());
+    case Type::UInt32: return load(uint32_t());
+    case Type::Float32: return load(float());
+    case Type::Float64: return load(double());
+    default: return T();
+    }
+  }
+
+  // Parses one value of the body, ascii or binary. Returns the position past
+  // it or nullptr.
+  template <typename T>
+  inline const char* parseValue(const char* p, const char* end, Type type, Format format, T& out) {
+    if (format == Format::Ascii) {
+      p = scan::skipSpace(p, end);
+      if (type == Type::Float32 || type == Type::Float64) return scan::parseFloat(p, end, out);
+      int64_t v;
+      if (!(p = scan::parseInt(p, end, v))) return nullptr;
+      out = static_cast<T>(v);
+      return p;
+    }
+    size_t size = sizeOf(type);
+    if (size_t(end - p) < size) return nullptr;
+    out = read<T>(p, type, !isNativeOrder(format));
+    return p + size;
+  }
+
+  // Walks the rows of an element and hands every value, list items included,
+  // to onValue(row, property, value). Returns the end of the element or nullptr.
+  template <typename Scalar, typename OnValue>
+  inline const char* parseElement(const char* p, const char* end, Format format, const Element& element,
+    OnValue&& onValue)
+  {
+    for (size_t row = 0; row < element.count; row++) {
+      for (size_t i = 0; i < element.properties.size(); i++) {
+        const Property& property = element.properties[i];
+        size_t count = 1;
+        if (property.countType != Type::Invalid && !(p = parseValue(p, end, property.countType, format, count)))
+          return nullptr;
+        for (size_t k = 0; k < count; k++) {
+          Scalar v{};
+          if (!(p = parseValue(p, end, property.type, format, v))) return nullptr;
+          onValue(row, int(i), v);
+        }
+      }
+    }
+    return p;
+  }
+
+  // Appends the polygon as a fan of triangles around its first corner.
+  // Points and lines are dropped.
+  template <typename Index>
+  inline void appendFan(const std::vector<Index>& face, std::vector<Index>& F) {
+    for (size_t k = 2; k < face.size(); k++) {
+      F.push_back(face[0]);
+      F.push_back(face[k - 1]);
+      F.push_back(face[k]);
+    }
+  }
+}
+
+// Reads positions and faces of an ascii or binary PLY file into V with x y z
+// per vertex and F with three vertex indices per triangle, as readOFF does
+// for triangle meshes. Polygons are split into fans. Binary vertices with consecutive float x y z are
+// copied with one memcpy per row, or a single memcpy if those are the only
+// properties, and binary faces are read straight from the mapping.
+template <typename Scalar, typename Index>
+inline bool readPLY(
+  const std::string file_name,
+  std::vector<Scalar>& V,
+  std::vector<Index>& F)
+{
+  V.clear();
+  F.clear();
+
+  MappedFile file(file_name);
+  if (!file) {
+    printf("readPLY() failed, cannot map %s\n", file_name.c_str());
+    return false;
+  }
+
+  const char* end = file.end();
+  ply::Header header;
+  const char* p = ply::parseHeader(file.begin(), end, header);
+  if (!p) return false;
+  bool binary = header.format != ply::Format::Ascii;
+  bool native = ply::isNativeOrder(header.format);
+
+  for (const ply::Element& element : header.elements) {
+    if (element.name == "vertex") {
+      int xyz[3] = { element.find("x"), element.find("y"), element.find("z") };
+      if (std::find(xyz, xyz + 3, -1) != xyz + 3) {
+        printf("readPLY() failed, vertices need x, y and z\n");
+        return false;
+      }
+      V.resize(element.count * 3);
+
+      size_t stride = element.stride();
+      if (binary && stride && size_t(end - p) < element.count * stride) {
+        printf("readPLY() failed, truncated vertices\n");
+        return false;
+      }
+      bool packed = xyz[1] == xyz[0] + 1 && xyz[2] == xyz[1] + 1;
+      for (int k = 0; k < 3; k++) packed &= element.properties[xyz[k]].type == ply::Type::Float32;
+      if constexpr (std::is_same_v<Scalar, float>) {
+        if (binary && native && stride && packed) {
+          size_t offset = 0;
+          for (int i = 0; i < xyz[0]; i++) offset += ply::sizeOf(element.properties[i].type);
+          if (stride == 3 * sizeof(float)) std::memcpy(V.data(), p, element.count * stride);
+          else
+            for (size_t i = 0; i < element.count; i++)
+              std::memcpy(V.data() + i * 3, p + i * stride + offset, 3 * sizeof(float));
+          p += element.count * stride;
+          continue;
+        }
+      }
+
+      p = ply::parseElement<Scalar>(p, end, header.format, element, [&](size_t row, int property, Scalar v) {
+        for (int k = 0; k < 3; k++)
+          if (property == xyz[k]) V[row * 3 + k] = v;
+        });
+    }
+    else if (element.name == "face") {
+      int list = element.find("vertex_indices");
+      if (list < 0) list = element.find("vertex_index");
+      if (list < 0 || element.properties[list].countType == ply::Type::Invalid) {
+        printf("readPLY() failed, faces need a vertex_indices list\n");
+        return false;
+      }
+      F.reserve(element.count * 3);
+
+      const ply::Property& property = element.properties[list];
+      size_t countSize = ply::sizeOf(property.countType), indexSize = ply::sizeOf(property.type);
+      std::vector<Index> face;
+      if (binary && element.properties.size() == 1) {
+        bool swap = !native;
+        for (size_t row = 0; row < element.count && p; row++) {
+          size_t count = size_t(end - p) < countSize ? 0 : ply::read<size_t>(p, property.countType, swap);
+          if (size_t(end - p) < countSize + count * indexSize) {
+            p = nullptr;
+            break;
+          }
+          p += countSize;
+          face.clear();
+          for (size_t k = 0; k < count; k++, p += indexSize) face.push_back(ply::read<Index>(p, property.type, swap));
+          ply::appendFan(face, F);
+        }
+      }
+      else {
+        size_t faceRow = 0;
+        p = ply::parseElement<double>(p, end, header.format, element, [&](size_t row, int property, double v) {
+          if (property != list) return;
+          if (row != faceRow) {
+            ply::appendFan(face, F);
+            face.clear();
+            faceRow = row;
+          }
+          face.push_back(static_cast<Index>(v));
+          });
+        ply::appendFan(face, F);
+      }
+    }
+    else {
+      p = ply::parseElement<double>(p, end, header.format, element, [](size_t, int, double) {});
+    }
+
+    if (!p) {
+      printf("Error: bad %s data\n", element.name.c_str());
+      V.clear();
+      F.clear();
+      return false;
+    }
+  }
+  return true;
+}
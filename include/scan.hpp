@@ -0,0 +1,140 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Locale-independent number scanning over in-memory text. Like
+// std::from_chars, the parsers do not skip leading whitespace and return the
+// position past the parsed token, or nullptr if no number could be parsed.
+namespace scan {
+  inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+  inline bool isSpace(char c) { return isBlank(c) || c == '\n'; }
+  inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+  // skips whitespace up to, but not past, the end of the line
+  inline const char* skipBlank(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+  }
+
+  inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) p++;
+    return p;
+  }
+
+  // returns the start of the next line
+  inline const char* skipLine(const char* p, const char* end) {
+    if (p >= end) return end;
+    const void* nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char*>(nl) + 1 : end;
+  }
+
+  inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isSpace(*p)) p++;
+    return p;
+  }
+
+  template <typename T>
+  inline const char* parseInt(const char* p, const char* end, T& out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    if (p >= end || !isDigit(*p)) return nullptr;
+
+    int64_t v = 0;
+    for (; p < end && isDigit(*p); p++) v = v * 10 + (*p - '0');
+    out = static_cast<T>(neg ? -v : v);
+    return p;
+  }
+
+  // slow path for inf/nan, hex floats and values that cannot be converted exactly below
+  inline const char* parseDoubleSlow(const char* p, const char* end, double& out) {
+    if (p < end && *p == '+') p++;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto [ptr, ec] = std::from_chars(p, end, out);
+    return ec == std::errc() ? ptr : nullptr;
+#else
+    char buf[128];
+    size_t n = 0;
+    for (; p + n < end && n < sizeof(buf) - 1 && !isSpace(p[n]); n++) buf[n] = p[n];
+    buf[n] = '\0';
+    char* last;
+    out = std::strtod(buf, &last);
+    return last == buf ? nullptr : p + (last - buf);
+#endif
+  }
+
+  // Decimal significand and exponent are accumulated as integers. If both fit
+  // the range where a double multiply/divide is exact (Clinger's fast path),
+  // the result is correctly rounded and identical to strtod.
+  inline const char* parseDouble(const char* p, const char* end, double& out) {
+    static constexpr double pow10[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* start = p;
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+    uint64_t m = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false, truncated = false;
+    for (; p < end && isDigit(*p); p++, any = true) {
+      if (digits < 19) {
+        m = m * 10 + (*p - '0');
+        if (m) digits++;
+      }
+      else {
+        exp10++;
+        truncated |= *p != '0';
+      }
+    }
+    if (p < end && *p == '.') {
+      p++;
+      for (; p < end && isDigit(*p); p++, any = true) {
+        if (digits < 19) {
+          m = m * 10 + (*p - '0');
+          if (m) digits++;
+          exp10--;
+        }
+        else truncated |= *p != '0';
+      }
+    }
+    if (!any) return parseDoubleSlow(start, end, out);
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      const char* q = p + 1;
+      bool eneg = false;
+      if (q < end && (*q == '-' || *q == '+')) eneg = *q++ == '-';
+      if (q < end && isDigit(*q)) {
+        int e = 0;
+        for (; q < end && isDigit(*q); q++)
+          if (e < 100000) e = e * 10 + (*q - '0');
+        exp10 += eneg ? -e : e;
+        p = q;
+      }
+    }
+
+    if (m == 0 && !truncated) {
+      out = neg ? -0. : 0.;
+      return p;
+    }
+    if (truncated || m > (uint64_t(1) << 53) || exp10 < -22 || exp10 > 22)
+      return parseDoubleSlow(start, end, out) ? p : nullptr;
+
+    double v = static_cast<double>(m);
+    v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+    out = neg ? -v : v;
+    return p;
+  }
+
+  template <typename T>
+  inline const char* parseFloat(const char* p, const char* end, T& out) {
+    double v;
+    if (!(p = parseDouble(p, end, v))) return nullptr;
+    out = static_cast<T>(v);
+    return p;
+  }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "parallel.hpp"
+
+// Coroutines that hop between worker threads and the render thread, so
+// assets load in the background while frames keep presenting:
+//
+//   task::Task load() {
+//     co_await workers.schedule(); // disk and CPU work on a worker
+//     ...
+//     co_await frames.schedule();  // GPU uploads in the next frames.run()
+//     ...
+//   }
+namespace task {
+  // Owning handle of a coroutine that starts running immediately. The frame
+  // is kept after the coroutine finishes so the owner can poll and rethrow.
+  class Task {
+  public:
+    struct promise_type {
+      std::exception_ptr error;
+      std::atomic<bool> finished = false;
+
+      // marks the coroutine finished only once it is suspended for good, so
+      // the owner may destroy it from another thread right after
+      struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+          h.promise().finished.store(true, std::memory_order_release);
+        }
+        void await_resume() noexcept {}
+      };
+
+      Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      FinalAwaiter final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task() {}
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task(Task&& other) : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) {
+      if (this != &other) {
+        if (handle) handle.destroy();
+        handle = std::exchange(other.handle, {});
+      }
+      return *this;
+    }
+
+    // Must not be destroyed while the coroutine runs on another thread; stop
+    // the Pool it hops to first.
+    ~Task() {
+      if (handle) handle.destroy();
+    }
+
+    bool done() const { return !handle || handle.promise().finished.load(std::memory_order_acquire); }
+
+    // rethrows an exception that escaped the finished coroutine, once
+    void rethrow() {
+      if (done() && handle && handle.promise().error)
+        std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  };
+
+  // co_await queue.schedule() continues the coroutine wherever the queue resumes it
+  template <typename Queue>
+  struct Schedule {
+    Queue& queue;
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) { queue.push(h); }
+    void await_resume() {}
+  };
+
+  // Worker threads resuming coroutines in FIFO order. On destruction pending
+  // coroutines are dropped and running ones finish up to their next hop.
+  class Pool {
+  private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::coroutine_handle<>> pending;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    void work() {
+      for (;;) {
+        std::coroutine_handle<> h;
+        {
+          std::unique_lock lock(mutex);
+          wake.wait(lock, [&] { return stopping || !pending.empty(); });
+          if (stopping) return;
+          h = pending.front();
+          pending.pop_front();
+        }
+        h.resume();
+      }
+    }
+
+  public:
+    Pool(unsigned count = 0) {
+      count = count ? count : parallel::threadCount();
+      for (unsigned i = 0; i < count; i++) threads.emplace_back([this] { work(); });
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool() {
+      {
+        std::lock_guard lock(mutex);
+        stopping = true;
+      }
+      wake.notify_all();
+      for (auto& t : threads) t.join();
+    }
+
+    void push(std::coroutine_handle<> h) {
+      {
+        std::lock_guard lock(mutex);
+        pending.push_back(h);
+      }
+      wake.notify_one();
+    }
+
+    Schedule<Pool> schedule() { return { *this }; }
+  };
+
+  // Coroutines resumed by whichever thread calls run(), typically the render
+  // loop once per frame. Coroutines scheduled during run() wait for the next one.
+  class Queue {
+  private:
+    std::mutex mutex;
+    std::vector<std::coroutine_handle<>> pending;
+
+  public:
+    void push(std::coroutine_handle<> h) {
+      std::lock_guard lock(mutex);
+      pending.push_back(h);
+    }
+
+    Schedule<Queue> schedule() { return { *this }; }
+
+    // returns the number of coroutines resumed
+    size_t run() {
+      std::vector<std::coroutine_handle<>> ready;
+      {
+        std::lock_guard lock(mutex);
+        ready.swap(pending);
+      }
+      for (auto h : ready) h.resume();
+      return ready.size();
+    }
+  };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Bookkeeping of staged uploads, independent of the GPU API: writes are
+// copied into a staging area and recorded as copies to their destinations,
+// which land in the order they are recorded.
+namespace upload {
+  struct Copy {
+    const void* dst;
+    uint64_t dstOffset;
+    uint64_t srcOffset;
+    uint64_t size;
+  };
+
+  // The copies into one staging area of capacity bytes at data. Whoever
+  // submits the copies clears them and hands over the next staging area.
+  struct Batch {
+    uint64_t capacity;
+    uint8_t* data = nullptr;
+    uint64_t used = 0;
+    std::vector<Copy> copies;
+
+    explicit Batch(uint64_t capacity) : capacity(capacity) {}
+
+    // Stages as much of the write as fits and returns the bytes staged, 0
+    // when the staging area is full. A write inside or right after a
+    // pending copy to dst overwrites or extends it.
+    uint64_t stage(const void* dst, uint64_t offset, const void* src, uint64_t bytes) {
+      uint64_t room = capacity - used;
+      // the latest copy to dst decides, since it lands last
+      for (auto copy = copies.rbegin(); copy != copies.rend(); copy++) {
+        if (copy->dst != dst) continue;
+        uint64_t end = copy->dstOffset + copy->size;
+        if (offset >= copy->dstOffset && offset + bytes <= end) {
+          memcpy(data + copy->srcOffset + (offset - copy->dstOffset), src, bytes);
+          return bytes;
+        }
+        if (offset == end && copy->srcOffset + copy->size == used && room) {
+          uint64_t n = std::min(bytes, room);
+          memcpy(data + used, src, n);
+          used += n;
+          copy->size += n;
+          return n;
+        }
+        if (offset < end && copy->dstOffset < offset + bytes) break;
+      }
+
+      uint64_t n = std::min(bytes, room);
+      if (!n) return 0;
+      memcpy(data + used, src, n);
+      copies.push_back({ dst, offset, used, n });
+      used += n;
+      return n;
+    }
+
+    // Stages the whole write, in capacity sized chunks when it is larger
+    // than the staging area, calling submit() whenever the area is full.
+    // offset and bytes must be multiples of 4, and so must capacity.
+    template <typename Submit>
+    void write(const void* dst, uint64_t offset, const void* src, uint64_t bytes, Submit&& submit) {
+      const uint8_t* p = static_cast<const uint8_t*>(src);
+      while (bytes) {
+        uint64_t n = stage(dst, offset, p, bytes);
+        if (!n) {
+          submit();
+          continue;
+        }
+        p += n;
+        offset += n;
+        bytes -= n;
+      }
+    }
+  };
+}
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <SDL3/SDL.h>
 #include <webgpu.h>
 #include <wgpu.h>
 #include "sdl3webgpu.h"
+#include "upload.hpp"
 
 void LogOutputFunction(void* userdata, int category, SDL_LogPriority priority, const char* message) {
   const char* priority_name = NULL;
@@ -65,6 +75,122 @@ WGPUDevice requestDevice(WGPUAdapter adapter) {
 }
 
 namespace WGPU {
+  // Shader modules, bind group layouts and render pipelines keyed by their
+  // full content: modules by their WGSL source, layouts by their entries,
+  // and pipelines by a key that holds the source, the layouts and every
+  // piece of render state. Creating the same one again costs a hash lookup
+  // instead of a driver compile, and interned layouts let bind groups be
+  // shared by every pipeline made with an equal layout. The cache owns what
+  // it creates and releases it in clear(), before the device goes away.
+  class PipelineCache {
+  public:
+    struct Counters {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+    };
+
+    WGPUDevice device = nullptr;
+    Counters shaderModules;
+    Counters bindGroupLayouts;
+    Counters renderPipelines;
+
+    WGPUShaderModule shaderModule(const char* source) {
+      auto [it, inserted] = modules.try_emplace(source, nullptr);
+      if (!inserted) {
+        shaderModules.hits++;
+        return it->second;
+      }
+      shaderModules.misses++;
+      WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {
+        .code = source,
+        .chain = {
+          .sType = WGPUSType_ShaderModuleWGSLDescriptor
+        }
+      };
+      WGPUShaderModuleDescriptor descriptor{ .nextInChain = &shaderCodeDesc.chain };
+      return it->second = wgpuDeviceCreateShaderModule(device, &descriptor);
+    }
+
+    // The layout with the entries of descriptor, named by the label of the
+    // first descriptor with them.
+    WGPUBindGroupLayout bindGroupLayout(const WGPUBindGroupLayoutDescriptor& descriptor);
+
+    // The pipeline under key, made by create with the layout it uses on a
+    // miss.
+    WGPURenderPipeline renderPipeline(const std::string& key,
+      const std::function<std::pair<WGPURenderPipeline, WGPUPipelineLayout>()>& create)
+    {
+      auto it = pipelines.find(key);
+      if (it != pipelines.end()) {
+        renderPipelines.hits++;
+        return it->second.first;
+      }
+      renderPipelines.misses++;
+      return pipelines.emplace(key, create()).first->second.first;
+    }
+
+    void clear() {
+      for (auto& [key, pipeline] : pipelines) {
+        wgpuRenderPipelineRelease(pipeline.first);
+        wgpuPipelineLayoutRelease(pipeline.second);
+      }
+      for (auto& [key, layout] : layouts) wgpuBindGroupLayoutRelease(layout);
+      for (auto& [key, module] : modules) wgpuShaderModuleRelease(module);
+      pipelines.clear();
+      layouts.clear();
+      modules.clear();
+    }
+
+  private:
+    std::unordered_map<std::string, WGPUShaderModule> modules;
+    std::unordered_map<std::string, WGPUBindGroupLayout> layouts;
+    std::unordered_map<std::string, std::pair<WGPURenderPipeline, WGPUPipelineLayout>> pipelines;
+  };
+
+  // Appends scalars and strings to a byte string, the key of a
+  // PipelineCache entry. Descriptors are added field by field, since their
+  // padding is undefined and their pointers have to be followed.
+  struct CacheKey {
+    std::string bytes;
+
+    template <typename... T>
+    void add(const T&... values) {
+      (append(values), ...);
+    }
+
+  private:
+    template <typename T>
+    void append(const T& value) {
+      static_assert(std::is_scalar_v<T> && !std::is_pointer_v<T>);
+      bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void append(const char* text) {
+      if (text) bytes.append(text);
+      bytes.push_back('\0');
+    }
+  };
+
+  inline WGPUBindGroupLayout PipelineCache::bindGroupLayout(const WGPUBindGroupLayoutDescriptor& descriptor) {
+    CacheKey key;
+    key.add(descriptor.entryCount);
+    for (size_t i = 0; i < descriptor.entryCount; i++) {
+      auto& e = descriptor.entries[i];
+      key.add(e.binding, e.visibility,
+        e.buffer.type, e.buffer.hasDynamicOffset, e.buffer.minBindingSize,
+        e.sampler.type,
+        e.texture.sampleType, e.texture.viewDimension, e.texture.multisampled,
+        e.storageTexture.access, e.storageTexture.format, e.storageTexture.viewDimension);
+    }
+    auto [it, inserted] = layouts.try_emplace(std::move(key.bytes), nullptr);
+    if (!inserted) {
+      bindGroupLayouts.hits++;
+      return it->second;
+    }
+    bindGroupLayouts.misses++;
+    return it->second = wgpuDeviceCreateBindGroupLayout(device, &descriptor);
+  }
+
   class Context {
   public:
     SDL_Window* window;
@@ -76,6 +202,7 @@ namespace WGPU {
 
     std::tuple<uint32_t, uint32_t> size;
     float aspect;
+    PipelineCache pipelineCache;
 
     Context(int w, int h, WGPUTextureFormat surfaceFormat = WGPUTextureFormat_BGRA8UnormSrgb)
       : surfaceFormat(surfaceFormat), aspect(float(w) / float(h)) {
@@ -112,9 +239,11 @@ namespace WGPU {
       wgpuSurfaceConfigure(surface, &config);
 
       queue = wgpuDeviceGetQueue(device);
+      pipelineCache.device = device;
     }
 
     ~Context() {
+      pipelineCache.clear();
       wgpuQueueRelease(queue);
       wgpuDeviceRelease(device);
       wgpuTextureRelease(surfaceTexture.texture);
@@ -129,20 +258,9 @@ namespace WGPU {
     }
 
     void writeBuffer(WGPUBuffer buffer, uint64_t offset, const void* data, size_t size) {
-      wgpuQueueWriteBuffer(queue, buffer, 0, data, size);
+      wgpuQueueWriteBuffer(queue, buffer, offset, data, size);
     }
 
-    WGPUShaderModule createShaderModule(const char* source) {
-      WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {
-        .code = source,
-        .chain = {
-          .sType = WGPUSType_ShaderModuleWGSLDescriptor
-        }
-      };
-      WGPUShaderModuleDescriptor descriptor{ .nextInChain = &shaderCodeDesc.chain };
-      return wgpuDeviceCreateShaderModule(device, &descriptor);
-    };
-
     WGPURenderPipeline createRenderPipeline(const WGPURenderPipelineDescriptor* descripter) {
       return wgpuDeviceCreateRenderPipeline(device, descripter);
     }
@@ -194,13 +312,6 @@ namespace WGPU {
     }
   };
 
-  class ShaderModule {
-  public:
-    WGPUShaderModule handle;
-    ShaderModule(Context& ctx, const char* source) : handle(ctx.createShaderModule(source)) {}
-    ~ShaderModule() { wgpuShaderModuleRelease(handle); }
-  };
-
   class Buffer {
   private:
     Context& ctx;
@@ -221,16 +332,222 @@ namespace WGPU {
     }
 
     void write(const void* data, uint64_t offset = 0) {
-      ctx.writeBuffer(handle, offset, data, size);
+      ctx.writeBuffer(handle, offset, data, size - offset);
+    }
+
+    // offset and bytes must be multiples of 4
+    void write(const void* data, uint64_t offset, uint64_t bytes) {
+      ctx.writeBuffer(handle, offset, data, bytes);
+    }
+  };
+
+  // Uploads consecutive pieces of data to a buffer as they arrive, e.g. the
+  // batches of streamOFF. Queue writes have to be 4-byte aligned, so up to 3
+  // trailing bytes are held back until the next write or flush().
+  class BufferStream {
+  private:
+    Buffer& buffer;
+    uint8_t tail[4];
+    uint64_t tailSize = 0;
+
+  public:
+    uint64_t offset = 0;
+
+    BufferStream(Buffer& buffer) : buffer(buffer) {}
+
+    ~BufferStream() { flush(); }
+
+    void write(const void* data, uint64_t bytes) {
+      if (offset + tailSize + bytes > buffer.size) throw std::runtime_error("BufferStream overflow");
+
+      const uint8_t* p = static_cast<const uint8_t*>(data);
+      if (tailSize) {
+        for (; tailSize < 4 && bytes; bytes--) tail[tailSize++] = *p++;
+        if (tailSize < 4) return;
+        buffer.write(tail, offset, 4);
+        offset += 4;
+        tailSize = 0;
+      }
+
+      uint64_t aligned = bytes & ~uint64_t(3);
+      if (aligned) {
+        buffer.write(p, offset, aligned);
+        offset += aligned;
+      }
+      for (uint64_t i = aligned; i < bytes; i++) tail[tailSize++] = p[i];
+    }
+
+    // pads the held back bytes with zeros and uploads them
+    void flush() {
+      if (!tailSize) return;
+      while (tailSize < 4) tail[tailSize++] = 0;
+      buffer.write(tail, offset, 4);
+      offset += 4;
+      tailSize = 0;
     }
   };
 
+  // Uploads writes to buffers through a ring of staging buffers that stay
+  // mapped while they are filled. A write is copied into the current
+  // staging buffer and recorded as a copy to its destination; flush()
+  // submits the copies of the frame in one command buffer, which has to
+  // happen before the commands that read the destinations are submitted. A
+  // staging buffer is mapped again once the GPU has copied out of it, and
+  // the ring grows when none is mapped yet. Writes that land inside or
+  // right after a pending copy to the same buffer overwrite or extend it,
+  // so small updates coalesce into few copies.
+  class Uploader {
+  public:
+    struct Counters {
+      uint64_t writes = 0;
+      uint64_t copies = 0;
+      uint64_t bytes = 0;
+    };
+
+    // of the frame before the last flush()
+    Counters frame;
+
+    Uploader(Context& ctx, uint64_t capacity = 1 << 20) : ctx(ctx), batch{ capacity } {
+      current = acquire();
+      batch.data = current->data;
+    }
+
+    ~Uploader() {
+      // lets pending maps call back before their staging buffers go away
+      wgpuDevicePoll(ctx.device, true, nullptr);
+      for (auto& staging : ring) wgpuBufferRelease(staging->handle);
+    }
+
+    // offset and bytes must be multiples of 4. Writes larger than a staging
+    // buffer are staged in chunks, submitting each full staging buffer, so
+    // every write lands in call order.
+    void write(Buffer& buffer, uint64_t offset, const void* data, uint64_t bytes) {
+      if (!bytes) return;
+      pending.writes++;
+      pending.bytes += bytes;
+      batch.write(buffer.handle, offset, data, bytes, [this] { submit(); });
+    }
+
+    // submits the copies staged since the last flush and starts a new frame
+    void flush() {
+      submit();
+      frame = pending;
+      pending = {};
+    }
+
+  private:
+    struct Staging {
+      WGPUBuffer handle;
+      uint8_t* data = nullptr;
+      // set by the map callback
+      bool mapped = false;
+    };
+
+    Context& ctx;
+    upload::Batch batch;
+    std::vector<std::unique_ptr<Staging>> ring;
+    Staging* current;
+    Counters pending;
+
+    // a mapped staging buffer, or a new one when the GPU still copies out of
+    // all of them
+    Staging* acquire() {
+      wgpuDevicePoll(ctx.device, false, nullptr);
+      for (auto& staging : ring)
+        if (staging->mapped && !staging->data) {
+          staging->data = static_cast<uint8_t*>(wgpuBufferGetMappedRange(staging->handle, 0, batch.capacity));
+          return staging.get();
+        }
+      WGPUBufferDescriptor descriptor{
+        .label = "staging",
+        .usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+        .size = batch.capacity,
+        .mappedAtCreation = true,
+      };
+      auto& staging = ring.emplace_back(new Staging{ ctx.createBuffer(&descriptor) });
+      staging->mapped = true;
+      staging->data = static_cast<uint8_t*>(wgpuBufferGetMappedRange(staging->handle, 0, batch.capacity));
+      return staging.get();
+    }
+
+    void submit() {
+      if (batch.copies.empty()) return;
+      wgpuBufferUnmap(current->handle);
+      current->data = nullptr;
+      current->mapped = false;
+
+      WGPUCommandEncoderDescriptor encoderDescriptor{ .label = "uploads" };
+      WGPUCommandEncoder encoder = ctx.createCommandEncoder(&encoderDescriptor);
+      for (auto& copy : batch.copies)
+        wgpuCommandEncoderCopyBufferToBuffer(encoder, current->handle, copy.srcOffset, (WGPUBuffer)copy.dst, copy.dstOffset, copy.size);
+      WGPUCommandBufferDescriptor commandDescriptor{};
+      WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &commandDescriptor);
+      ctx.queueSubmit(1, &command);
+      wgpuCommandBufferRelease(command);
+      wgpuCommandEncoderRelease(encoder);
+      pending.copies += batch.copies.size();
+      batch.copies.clear();
+
+      wgpuBufferMapAsync(current->handle, WGPUMapMode_Write, 0, batch.capacity, [](WGPUBufferMapAsyncStatus status, void* userdata) {
+        if (status == WGPUBufferMapAsyncStatus_Success) static_cast<Staging*>(userdata)->mapped = true;
+        }, current);
+      current = acquire();
+      batch.data = current->data;
+      batch.used = 0;
+    }
+  };
+
+  // One uniform buffer sliced up for the data of every object of a frame,
+  // bound through a single bind group entry with hasDynamicOffset = true
+  // and the size of a slice. push() returns the dynamic offset of a slice;
+  // upload() writes all slices of the frame at once and starts over.
+  class UniformArena {
+  public:
+    // minUniformBufferOffsetAlignment of the default limits
+    static constexpr uint64_t alignment = 256;
+
+    Buffer buffer;
+
+    UniformArena(Context& ctx, uint64_t capacity, const char* label = "uniforms")
+      : buffer(ctx, {
+        .label = label,
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+        .size = capacity,
+        .mappedAtCreation = false,
+        }) {
+      data.reserve(buffer.size);
+    }
+
+    uint32_t push(const void* value, uint64_t bytes) {
+      uint64_t offset = data.size();
+      if (offset + bytes > buffer.size) throw std::runtime_error("UniformArena overflow");
+      data.resize(std::min(offset + (bytes + alignment - 1) / alignment * alignment, buffer.size));
+      memcpy(data.data() + offset, value, bytes);
+      return uint32_t(offset);
+    }
+
+    template <typename T>
+    uint32_t push(const T& value) {
+      return push(&value, sizeof(T));
+    }
+
+    void upload(Uploader& uploads) {
+      uploads.write(buffer, 0, data.data(), data.size());
+      data.clear();
+    }
+
+  private:
+    std::vector<uint8_t> data;
+  };
+
   class BindGroup {
   public:
     struct Entry {
       uint32_t binding;
       Buffer* buffer;
       uint64_t offset;
+      // bytes bound, 0 for the rest of the buffer
+      uint64_t size;
       WGPUShaderStageFlags visibility;
       WGPUBufferBindingLayout layout;
       WGPUSamplerBindingLayout sampler;
@@ -239,13 +556,15 @@ namespace WGPU {
     };
 
     WGPUBindGroup handle;
+    // interned in the pipeline cache, shared with equal bind groups
     WGPUBindGroupLayout layout;
-    WGPUBindGroupLayoutDescriptor layoutSpec;
 
+    // Created once and bound with RenderPass::setBindGroup() for every
+    // pipeline made with its layout.
     BindGroup(Context& ctx, const char* label, const std::vector<Entry>& entries) {
       size_t n = entries.size();
 
-      WGPUBindGroupLayoutEntry* layoutEntries = new WGPUBindGroupLayoutEntry[n];
+      std::vector<WGPUBindGroupLayoutEntry> layoutEntries(n);
       for (int i = 0; i < n; i++) layoutEntries[i] = WGPUBindGroupLayoutEntry{
         .binding = entries[i].binding,
         .visibility = entries[i].visibility,
@@ -254,34 +573,32 @@ namespace WGPU {
         .texture = entries[i].texture,
         .storageTexture = entries[i].storageTexture,
       };
-
-      layoutSpec = WGPUBindGroupLayoutDescriptor{
+      layout = ctx.pipelineCache.bindGroupLayout({
         .label = label,
         .entryCount = n,
-        .entries = layoutEntries
-      };
-      layout = ctx.createBindGroupLayout(&layoutSpec);
+        .entries = layoutEntries.data()
+        });
 
-      WGPUBindGroupEntry* bindGroupEntries = new WGPUBindGroupEntry[n];
+      std::vector<WGPUBindGroupEntry> bindGroupEntries(n);
       for (int i = 0; i < n; i++) bindGroupEntries[i] = WGPUBindGroupEntry{
         .binding = entries[i].binding,
         .buffer = entries[i].buffer->handle,
         .offset = entries[i].offset,
-        .size = entries[i].buffer->size
+        .size = entries[i].size ? entries[i].size : entries[i].buffer->size - entries[i].offset
       };
 
       WGPUBindGroupDescriptor descriptor{
-        .label = layoutSpec.label,
+        .label = label,
         .layout = layout,
         .entryCount = n,
-        .entries = bindGroupEntries
+        .entries = bindGroupEntries.data()
       };
       handle = ctx.createBindGroup(&descriptor);
-
-      delete[] layoutEntries;
-      delete[] bindGroupEntries;
     }
 
+    BindGroup(const BindGroup&) = delete;
+    BindGroup& operator=(const BindGroup&) = delete;
+
     ~BindGroup() {
       wgpuBindGroupRelease(handle);
     }
@@ -296,14 +613,10 @@ namespace WGPU {
 
   class RenderPipeline {
   public:
-    struct BindGroupEntry {
-      const char* label;
-      const std::vector<BindGroup::Entry>& entries;
-    };
-
     struct Descriptor {
       const char* source;
-      std::vector<BindGroupEntry>const& bindGroups;
+      // the layouts of the bind groups, by group index
+      std::vector<WGPUBindGroupLayout>const& bindGroupLayouts;
       struct {
         char const* entryPoint;
         std::vector<VertexBuffer>const& buffers;
@@ -317,83 +630,101 @@ namespace WGPU {
     };
 
     WGPURenderPipeline handle;
-    std::vector<BindGroup> bindGroups;
 
+    // Looks the pipeline up in the pipeline cache of ctx, which owns it.
     RenderPipeline(WGPU::Context& ctx, const Descriptor& desc) {
-      WGPU::ShaderModule shaderModule(ctx, desc.source);
-
-      size_t bindGroupLayoutCount = desc.bindGroups.size();
-      WGPUBindGroupLayout* bindGroupLayouts = new WGPUBindGroupLayout[bindGroupLayoutCount];
-      for (int i = 0; i < bindGroupLayoutCount; i++) {
-        bindGroups.emplace_back(ctx, desc.bindGroups[i].label, desc.bindGroups[i].entries);
-        bindGroupLayouts[i] = bindGroups[i].layout;
-      }
-
-      size_t bufferCount = desc.vertex.buffers.size();
-      WGPUVertexBufferLayout* buffers = new WGPUVertexBufferLayout[bufferCount];
-      for (int i = 0; i < bufferCount; i++) {
-        auto& buf = desc.vertex.buffers[i];
-        buffers[i] = {
-          .attributeCount = buf.attributes.size(),
-          .attributes = buf.attributes.data(),
-          .arrayStride = buf.arrayStride,
-          .stepMode = buf.stepMode,
-        };
-      }
-
-      WGPUPipelineLayoutDescriptor lDescriptor{
-        .bindGroupLayoutCount = bindGroupLayoutCount,
-        .bindGroupLayouts = bindGroupLayouts,
-      };
-      WGPUFragmentState fragmentState{
-        .module = shaderModule.handle,
-        .entryPoint = desc.fragment.entryPoint,
-        .targetCount = desc.fragment.targets.size(),
-        .targets = desc.fragment.targets.data(),
-      };
-      WGPUDepthStencilState depthStencilState{
-        .format = WGPUTextureFormat_Depth24Plus,
-        .depthWriteEnabled = true,
-        .depthCompare = WGPUCompareFunction_Less,
-        .stencilReadMask = 0,
-        .stencilWriteMask = 0,
-        .depthBias = 0,
-        .depthBiasSlopeScale = 0,
-        .depthBiasClamp = 0,
-        .stencilFront = {
-          .compare = WGPUCompareFunction_Always,
-          .failOp = WGPUStencilOperation_Keep,
-          .depthFailOp = WGPUStencilOperation_Keep,
-          .passOp = WGPUStencilOperation_Keep,
-        },
-        .stencilBack = {
-          .compare = WGPUCompareFunction_Always,
-          .failOp = WGPUStencilOperation_Keep,
-          .depthFailOp = WGPUStencilOperation_Keep,
-          .passOp = WGPUStencilOperation_Keep,
+      handle = ctx.pipelineCache.renderPipeline(cacheKey(desc), [&] {
+        WGPUShaderModule shaderModule = ctx.pipelineCache.shaderModule(desc.source);
+
+        size_t bufferCount = desc.vertex.buffers.size();
+        std::vector<WGPUVertexBufferLayout> buffers(bufferCount);
+        for (int i = 0; i < bufferCount; i++) {
+          auto& buf = desc.vertex.buffers[i];
+          buffers[i] = {
+            .attributeCount = buf.attributes.size(),
+            .attributes = buf.attributes.data(),
+            .arrayStride = buf.arrayStride,
+            .stepMode = buf.stepMode,
+          };
         }
-      };
-      WGPURenderPipelineDescriptor pDescriptor{
-        .layout = ctx.createPipelineLayout(&lDescriptor),
-        .vertex = {
-          .module = shaderModule.handle,
-          .bufferCount = bufferCount,
-          .buffers = buffers,
-          .entryPoint = desc.vertex.entryPoint
-        },
-        .primitive = desc.primitive,
-        .fragment = &fragmentState,
-        .depthStencil = &depthStencilState,
-        .multisample = desc.multisample,
-      };
-      handle = ctx.createRenderPipeline(&pDescriptor);
 
-      delete[] bindGroupLayouts;
-      delete[] buffers;
+        WGPUPipelineLayoutDescriptor lDescriptor{
+          .bindGroupLayoutCount = desc.bindGroupLayouts.size(),
+          .bindGroupLayouts = desc.bindGroupLayouts.data(),
+        };
+        WGPUFragmentState fragmentState{
+          .module = shaderModule,
+          .entryPoint = desc.fragment.entryPoint,
+          .targetCount = desc.fragment.targets.size(),
+          .targets = desc.fragment.targets.data(),
+        };
+        WGPUPipelineLayout layout = ctx.createPipelineLayout(&lDescriptor);
+        WGPURenderPipelineDescriptor pDescriptor{
+          .layout = layout,
+          .vertex = {
+            .module = shaderModule,
+            .bufferCount = bufferCount,
+            .buffers = buffers.data(),
+            .entryPoint = desc.vertex.entryPoint
+          },
+          .primitive = desc.primitive,
+          .fragment = &fragmentState,
+          .depthStencil = &depthStencilState,
+          .multisample = desc.multisample,
+        };
+        return std::make_pair(ctx.createRenderPipeline(&pDescriptor), layout);
+        });
     }
 
-    ~RenderPipeline() {
-      wgpuRenderPipelineRelease(handle);
+  private:
+    static constexpr WGPUDepthStencilState depthStencilState{
+      .format = WGPUTextureFormat_Depth24Plus,
+      .depthWriteEnabled = true,
+      .depthCompare = WGPUCompareFunction_Less,
+      .stencilReadMask = 0,
+      .stencilWriteMask = 0,
+      .depthBias = 0,
+      .depthBiasSlopeScale = 0,
+      .depthBiasClamp = 0,
+      .stencilFront = {
+        .compare = WGPUCompareFunction_Always,
+        .failOp = WGPUStencilOperation_Keep,
+        .depthFailOp = WGPUStencilOperation_Keep,
+        .passOp = WGPUStencilOperation_Keep,
+      },
+      .stencilBack = {
+        .compare = WGPUCompareFunction_Always,
+        .failOp = WGPUStencilOperation_Keep,
+        .depthFailOp = WGPUStencilOperation_Keep,
+        .passOp = WGPUStencilOperation_Keep,
+      }
+    };
+
+    // everything the pipeline of desc is made from; the depth state is the
+    // same for all
+    static std::string cacheKey(const Descriptor& desc) {
+      CacheKey key;
+      key.add(desc.source, desc.vertex.entryPoint, desc.fragment.entryPoint);
+      // layouts are interned, so equal ones are the same handle
+      key.add(desc.bindGroupLayouts.size());
+      for (WGPUBindGroupLayout layout : desc.bindGroupLayouts) key.add(reinterpret_cast<uintptr_t>(layout));
+      key.add(desc.vertex.buffers.size());
+      for (auto& buf : desc.vertex.buffers) {
+        key.add(buf.arrayStride, buf.stepMode, buf.attributes.size());
+        for (auto& a : buf.attributes) key.add(a.format, a.offset, a.shaderLocation);
+      }
+      auto& p = desc.primitive;
+      key.add(p.topology, p.stripIndexFormat, p.frontFace, p.cullMode);
+      key.add(desc.fragment.targets.size());
+      for (auto& t : desc.fragment.targets) {
+        key.add(t.format, t.writeMask, t.blend != nullptr);
+        if (t.blend)
+          key.add(t.blend->color.operation, t.blend->color.srcFactor, t.blend->color.dstFactor,
+            t.blend->alpha.operation, t.blend->alpha.srcFactor, t.blend->alpha.dstFactor);
+      }
+      auto& m = desc.multisample;
+      key.add(m.count, m.mask, m.alphaToCoverageEnabled);
+      return std::move(key.bytes);
     }
   };
 
@@ -403,16 +734,35 @@ namespace WGPU {
     uint32_t count;
   };
 
+  struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t count;
+    int32_t baseVertex;
+  };
+
   struct IndexedGeometry {
     WGPUPrimitiveState primitive;
     std::vector<VertexBuffer> vertexBuffers;
     WGPU::Buffer& indexBuffer;
     uint32_t count;
+    WGPUIndexFormat indexFormat = WGPUIndexFormat_Uint16;
+    // drawn instead of [0, count) when set, e.g. the clusters of a mesh split for 16-bit indices
+    std::vector<IndexRange> ranges;
   };
 
+  // Records state and draws into a render pass. Calls that would bind what
+  // is already bound are skipped: the pipeline, bind groups with their
+  // dynamic offsets, and vertex and index buffers with offset and size.
   class RenderPass {
   public:
+    // state calls issued to the encoder and skipped since the pass began
+    struct Counters {
+      uint64_t issued = 0;
+      uint64_t skipped = 0;
+    };
+
     WGPURenderPassEncoder handle;
+    Counters counters;
 
     RenderPass(WGPUCommandEncoder encoder, const WGPURenderPassDescriptor* descripter) {
       handle = wgpuCommandEncoderBeginRenderPass(encoder, descripter);
@@ -422,31 +772,89 @@ namespace WGPU {
       wgpuRenderPassEncoderRelease(handle);
     }
 
+    // Bind groups stay bound across pipeline switches, for every pipeline
+    // whose layout at that index is the layout of the group.
     void setPipeline(RenderPipeline& pipeline) {
+      if (!changed(pipeline.handle == boundPipeline)) return;
+      boundPipeline = pipeline.handle;
       wgpuRenderPassEncoderSetPipeline(handle, pipeline.handle);
-      for (int i = 0, n = pipeline.bindGroups.size(); i < n; i++)
-        wgpuRenderPassEncoderSetBindGroup(handle, i, pipeline.bindGroups[i].handle, 0, nullptr);
+    }
+
+    void setBindGroup(uint32_t index, const BindGroup& group, std::span<const uint32_t> dynamicOffsets = {}) {
+      if (index >= bindGroups.size()) bindGroups.resize(index + 1);
+      auto& bound = bindGroups[index];
+      if (!changed(bound.handle == group.handle && std::ranges::equal(bound.offsets, dynamicOffsets))) return;
+      bound.handle = group.handle;
+      bound.offsets.assign(dynamicOffsets.begin(), dynamicOffsets.end());
+      wgpuRenderPassEncoderSetBindGroup(handle, index, group.handle, dynamicOffsets.size(), dynamicOffsets.data());
+    }
+
+    // for a group with one dynamic offset, e.g. a slice of a UniformArena
+    void setBindGroup(uint32_t index, const BindGroup& group, uint32_t dynamicOffset) {
+      setBindGroup(index, group, std::span(&dynamicOffset, 1));
+    }
+
+    void setVertexBuffer(uint32_t slot, const Buffer& buffer, uint64_t offset = 0, uint64_t size = WGPU_WHOLE_SIZE) {
+      if (size == WGPU_WHOLE_SIZE) size = buffer.size - offset;
+      if (slot >= vertexBuffers.size()) vertexBuffers.resize(slot + 1);
+      BoundBuffer next{ buffer.handle, offset, size };
+      if (!changed(vertexBuffers[slot] == next)) return;
+      vertexBuffers[slot] = next;
+      wgpuRenderPassEncoderSetVertexBuffer(handle, slot, buffer.handle, offset, size);
+    }
+
+    void setIndexBuffer(const Buffer& buffer, WGPUIndexFormat format, uint64_t offset = 0, uint64_t size = WGPU_WHOLE_SIZE) {
+      if (size == WGPU_WHOLE_SIZE) size = buffer.size - offset;
+      BoundBuffer next{ buffer.handle, offset, size };
+      if (!changed(indexBuffer == next && indexFormat == format)) return;
+      indexBuffer = next;
+      indexFormat = format;
+      wgpuRenderPassEncoderSetIndexBuffer(handle, buffer.handle, format, offset, size);
     }
 
     void draw(Geometry& geom, uint32_t instanceCount = 1, uint32_t firstIndex = 0, uint32_t firstInstance = 0) {
-      for (int i = 0; i < geom.vertexBuffers.size(); i++) {
-        auto& buf = geom.vertexBuffers[i].buffer;
-        wgpuRenderPassEncoderSetVertexBuffer(handle, i, buf.handle, 0, buf.size);
-      }
+      for (uint32_t i = 0; i < geom.vertexBuffers.size(); i++)
+        setVertexBuffer(i, geom.vertexBuffers[i].buffer);
       wgpuRenderPassEncoderDraw(handle, geom.count, instanceCount, firstIndex, firstInstance);
     }
     void draw(IndexedGeometry& geom, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t baseVertex = 0, uint32_t firstInstance = 0) {
-      for (int i = 0; i < geom.vertexBuffers.size(); i++) {
-        auto& buf = geom.vertexBuffers[i].buffer;
-        wgpuRenderPassEncoderSetVertexBuffer(handle, i, buf.handle, 0, buf.size);
-      }
-      wgpuRenderPassEncoderSetIndexBuffer(handle, geom.indexBuffer.handle, WGPUIndexFormat_Uint16, 0, geom.indexBuffer.size);
-      wgpuRenderPassEncoderDrawIndexed(handle, geom.count, instanceCount, firstIndex, baseVertex, firstInstance);
+      for (uint32_t i = 0; i < geom.vertexBuffers.size(); i++)
+        setVertexBuffer(i, geom.vertexBuffers[i].buffer);
+      setIndexBuffer(geom.indexBuffer, geom.indexFormat);
+      if (geom.ranges.empty())
+        wgpuRenderPassEncoderDrawIndexed(handle, geom.count, instanceCount, firstIndex, baseVertex, firstInstance);
+      for (auto& range : geom.ranges)
+        wgpuRenderPassEncoderDrawIndexed(handle, range.count, instanceCount,
+          firstIndex + range.firstIndex, baseVertex + range.baseVertex, firstInstance);
     }
 
     void end() {
       wgpuRenderPassEncoderEnd(handle);
     }
+
+  private:
+    struct BoundGroup {
+      WGPUBindGroup handle = nullptr;
+      std::vector<uint32_t> offsets;
+    };
+    struct BoundBuffer {
+      WGPUBuffer handle = nullptr;
+      uint64_t offset = 0;
+      uint64_t size = 0;
+      bool operator==(const BoundBuffer&) const = default;
+    };
+
+    WGPURenderPipeline boundPipeline = nullptr;
+    std::vector<BoundGroup> bindGroups;
+    std::vector<BoundBuffer> vertexBuffers;
+    BoundBuffer indexBuffer;
+    WGPUIndexFormat indexFormat = WGPUIndexFormat_Undefined;
+
+    // counts a state call, which is issued unless it binds what is bound
+    bool changed(bool same) {
+      (same ? counters.skipped : counters.issued)++;
+      return !same;
+    }
   };
 
   class CommandEncoder {
@@ -0,0 +1,39 @@
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+#include "math.hpp"
+
+TEST_CASE("math::models", "") {
+  // 19 instances cover two full packets and a tail
+  size_t count = 19;
+  std::vector<float> x(count), y(count), z(count), qx(count), qy(count), qz(count), qw(count);
+  for (size_t i = 0; i < count; i++) {
+    Eigen::Quaternionf q;
+    Eigen::Vector3f axis = Eigen::Vector3f(std::cos(i * .7f), std::sin(i * 1.3f), .5f).normalized();
+    math::axisAngle(q, axis, i * .4f);
+    qx[i] = q.x(); qy[i] = q.y(); qz[i] = q.z(); qw[i] = q.w();
+    x[i] = i * .5f; y[i] = -float(i); z[i] = 3 - i * .25f;
+  }
+  math::Poses poses{ x.data(), y.data(), z.data(), qx.data(), qy.data(), qz.data(), qw.data() };
+
+  Eigen::Matrix4f proj = Eigen::Matrix4f::Zero(), view;
+  math::perspective(proj, math::radians(45), 1.5f, .1f, 100);
+  math::lookAt(view, Eigen::Vector3f(1, 2, 5), Eigen::Vector3f(0, -.4f, -1).normalized(), Eigen::Vector3f::UnitY());
+  Eigen::Matrix4f viewProjection = proj * view;
+
+  // one more than count, which nothing may write
+  std::vector<float> models((count + 1) * 16, -7), mvps((count + 1) * 16, -7);
+  math::models(poses, count, models.data());
+  math::modelViewProjections(viewProjection, poses, count, mvps.data());
+  for (size_t i = 0; i < count; i++) {
+    Eigen::Matrix4f expected;
+    math::rotation(expected, Eigen::Quaternionf(qw[i], qx[i], qy[i], qz[i]));
+    expected.col(3).head<3>() << x[i], y[i], z[i];
+    REQUIRE((Eigen::Map<Eigen::Matrix4f>(&models[i * 16]) - expected).cwiseAbs().maxCoeff() < 1e-5f * expected.cwiseAbs().maxCoeff());
+    Eigen::Matrix4f mvp = viewProjection * expected;
+    REQUIRE((Eigen::Map<Eigen::Matrix4f>(&mvps[i * 16]) - mvp).cwiseAbs().maxCoeff() < 1e-5f * mvp.cwiseAbs().maxCoeff());
+  }
+  for (size_t k = count * 16; k < models.size(); k++) {
+    REQUIRE(models[k] == -7);
+    REQUIRE(mvps[k] == -7);
+  }
+}
@@ -0,0 +1,42 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "mesh.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("split16", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+
+  // small clusters so the screwdriver splits into many
+  std::vector<uint16_t> local;
+  std::vector<uint32_t> remap;
+  auto clusters = mesh::split16(F.data(), F.size(), vertexCount, local, remap, 500);
+  REQUIRE(clusters.size() > 6);
+  REQUIRE(local.size() == F.size());
+  REQUIRE(remap.size() >= vertexCount);
+
+  std::vector<float> W(remap.size() * 3);
+  mesh::remapStream(V.data(), 3, remap, W.data());
+
+  uint32_t next = 0;
+  for (auto& c : clusters) {
+    REQUIRE(c.firstIndex == next);
+    REQUIRE(c.vertexCount <= 500);
+    for (uint32_t i = c.firstIndex; i < c.firstIndex + c.indexCount; i++) {
+      REQUIRE(local[i] < c.vertexCount);
+      uint32_t v = c.baseVertex + local[i];
+      REQUIRE(remap[v] == F[i]);
+      REQUIRE(W[v * 3 + 2] == V[F[i] * 3 + 2]);
+    }
+    next += c.indexCount;
+  }
+  REQUIRE(next == F.size());
+
+  // everything fits one cluster at the default size
+  clusters = mesh::split16(F.data(), F.size(), vertexCount, local, remap);
+  REQUIRE(clusters.size() == 1);
+  REQUIRE(clusters[0].vertexCount <= vertexCount);
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "primitive.hpp"
+#include "mesh.hpp"
+#include "mesh_ao.hpp"
+#include "mesh_normals.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("Bvh::occluded", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  mesh::normalize(V.data(), V.size() / 3);
+  mesh::Bvh bvh(F.data(), F.size(), V.data());
+
+  // every lane agrees with the nearest hit of its ray
+  size_t blocked = 0;
+  for (int i = 0; i < 100; i++) {
+    Eigen::Vector3f origin((i % 5) * .1f - .2f, (i % 7) * .1f - .3f, (i % 3) * .05f - .05f);
+    mesh::Bvh::Packet directions[3];
+    for (int k = 0; k < 8; k++) {
+      float a = (i * 8 + k) * .37f, b = (i * 8 + k) * .91f;
+      directions[0][k] = std::cos(a) * std::cos(b);
+      directions[1][k] = std::sin(b);
+      directions[2][k] = std::sin(a) * std::cos(b);
+    }
+    float distance = (i % 4 + 1) * .1f;
+    uint32_t mask = bvh.occluded(origin, directions, distance);
+    for (int k = 0; k < 8; k++) {
+      mesh::Ray ray{ origin, Eigen::Vector3f(directions[0][k], directions[1][k], directions[2][k]) };
+      REQUIRE(bool(mask >> k & 1) == bool(bvh.intersect(ray, distance)));
+    }
+    blocked += std::popcount(mask);
+  }
+  REQUIRE(blocked > 0);
+  REQUIRE(blocked < 800);
+}
+
+TEST_CASE("bakeOcclusion", "") {
+  // nothing blocks the outside of a cube, the inside is closed
+  auto cube = prim::generate(prim::Cube{});
+  std::vector<float> V, N;
+  std::vector<uint16_t> F = cube.indices;
+  for (auto& v : cube.vertices) {
+    V.insert(V.end(), v.position, v.position + 3);
+    N.insert(N.end(), v.normal, v.normal + 3);
+  }
+  size_t count = V.size() / 3;
+  mesh::Bvh box(F.data(), F.size(), V.data());
+  std::vector<float> visibility(count);
+  mesh::bakeOcclusion(box, V.data(), N.data(), count, visibility.data(), 32, 10.f);
+  for (float v : visibility) REQUIRE(v == 1);
+
+  for (float& n : N) n = -n;
+  mesh::bakeOcclusion(box, V.data(), N.data(), count, visibility.data(), 32, 10.f);
+  for (float v : visibility) REQUIRE(v < .1f);
+
+  // a scan has crevices, and the result does not depend on the threads
+  std::vector<uint32_t> indices;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, indices));
+  count = V.size() / 3;
+  mesh::normalize(V.data(), count);
+  N.resize(V.size());
+  mesh::computeNormals(indices.data(), indices.size(), V.data(), count, N.data(), mesh::NormalWeight::Angle);
+  mesh::Bvh bvh(indices.data(), indices.size(), V.data());
+  visibility.resize(count);
+  std::vector<float> single(count);
+  mesh::bakeOcclusion(bvh, V.data(), N.data(), count, visibility.data(), 20);
+  mesh::bakeOcclusion(bvh, V.data(), N.data(), count, single.data(), 24, .1f, 1);
+  REQUIRE(visibility == single);
+  size_t occluded = 0;
+  for (float v : visibility) {
+    REQUIRE((v >= 0 && v <= 1));
+    occluded += v < 1;
+  }
+  REQUIRE(occluded > 0);
+  REQUIRE(occluded < count);
+}
@@ -0,0 +1,115 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "math.hpp"
+#include "mesh.hpp"
+#include "mesh_bvh.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("Bvh", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+  mesh::normalize(V.data(), vertexCount);
+
+  mesh::Bvh bvh(F.data(), F.size(), V.data()), single(F.data(), F.size(), V.data(), 1);
+  REQUIRE(bvh.triangles.size() == F.size() / 3);
+  std::vector<uint32_t> sorted = bvh.triangles;
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t t = 0; t < sorted.size(); t++) REQUIRE(sorted[t] == t);
+
+  // every node bounds the nodes and triangles below it
+  for (auto& node : bvh.nodes) {
+    auto inside = [&](const float* p) {
+      for (int k = 0; k < 3; k++)
+        if (p[k] < node.min[k] || p[k] > node.max[k]) return false;
+      return true;
+    };
+    if (node.count)
+      for (uint32_t s = node.first; s < node.first + node.count; s++)
+        for (int k = 0; k < 3; k++) REQUIRE(inside(&V[F[bvh.triangles[s] * 3 + k] * 3]));
+    else
+      for (uint32_t c = node.first; c < node.first + 2; c++) {
+        REQUIRE(inside(bvh.nodes[c].min));
+        REQUIRE(inside(bvh.nodes[c].max));
+      }
+  }
+
+  // rays from around the mesh hit what testing every triangle hits
+  size_t hits = 0;
+  for (int i = 0; i < 200; i++) {
+    float a = i * .7f, b = i * .3f;
+    Eigen::Vector3f origin(2 * std::cos(a) * std::cos(b), 2 * std::sin(b), 2 * std::sin(a) * std::cos(b));
+    Eigen::Vector3f target((i % 7) * .05f - .15f, (i % 11) * .05f - .25f, (i % 5) * .02f - .04f);
+    mesh::Ray ray{ origin, target - origin };
+
+    mesh::RayHit expected;
+    for (uint32_t t = 0; t < F.size() / 3; t++) {
+      Eigen::Map<const Eigen::Vector3f> p0(&V[F[t * 3] * 3]), p1(&V[F[t * 3 + 1] * 3]), p2(&V[F[t * 3 + 2] * 3]);
+      Eigen::Matrix3f m;
+      m << -ray.direction, p1 - p0, p2 - p0;
+      if (m.determinant() == 0) continue;
+      Eigen::Vector3f x = m.inverse() * (ray.origin - p0);
+      if (x[0] >= 0 && x[1] >= 0 && x[2] >= 0 && x[1] + x[2] <= 1 && x[0] < expected.t) expected = { x[0], t, x[1], x[2] };
+    }
+
+    mesh::RayHit hit = bvh.intersect(ray);
+    REQUIRE(bool(hit) == bool(expected));
+    if (!hit) continue;
+    hits++;
+    REQUIRE(std::abs(hit.t - expected.t) < 1e-4f);
+    REQUIRE(single.intersect(ray).t == hit.t);
+    // nothing before the hit
+    REQUIRE(!bvh.intersect(ray, hit.t * .999f));
+  }
+  REQUIRE(hits > 100);
+
+  // the ray through the center of the screen goes down the view direction
+  Eigen::Matrix4f proj, view;
+  math::perspective(proj, math::radians(45), 16 / 9.f, .1f, 100.f);
+  math::lookAt(view, Eigen::Vector3f(0, 0, 5), Eigen::Vector3f(0, 0, -1), Eigen::Vector3f(0, 1, 0));
+  mesh::Ray center = mesh::Ray::unproject(proj * view, Eigen::Vector2f(0, 0));
+  REQUIRE((center.origin - Eigen::Vector3f(0, 0, 4.9f)).norm() < 1e-4f);
+  REQUIRE(center.direction.normalized().dot(Eigen::Vector3f(0, 0, -1)) > .9999f);
+  mesh::RayHit front = bvh.intersect(center);
+  REQUIRE(front);
+  REQUIRE(center.at(front.t).z() > 0);
+}
+
+TEST_CASE("Bvh deep", "") {
+  // large triangles across each axis at 17 times the distance of the
+  // previous one on that axis, so every split can only take off the
+  // farthest on one axis and the hierarchy gets deeper than 64
+  const float L = std::ldexp(1.f, 40);
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  std::vector<std::pair<int, float>> planes;
+  for (int k = 0; k < 3; k++)
+    for (float c = -std::ldexp(1.f, -120); c > -L; c *= 17) {
+      planes.push_back({ k, c });
+      float corners[3][2] = { { -3 * L, -3 * L }, { 3 * L, -3 * L }, { 0, 3 * L } };
+      for (auto& corner : corners) {
+        float p[3];
+        p[k] = c;
+        p[(k + 1) % 3] = corner[0];
+        p[(k + 2) % 3] = corner[1];
+        V.insert(V.end(), p, p + 3);
+        F.push_back(uint32_t(F.size()));
+      }
+    }
+  mesh::Bvh bvh(F.data(), F.size(), V.data());
+  REQUIRE(bvh.depth > 64);
+
+  // rays from halfway to every triangle on the way out hit that triangle
+  for (uint32_t t = 0; t < planes.size(); t++) {
+    auto [k, c] = planes[t];
+    mesh::Ray ray{ Eigen::Vector3f::Zero(), -Eigen::Vector3f::Unit(k) };
+    ray.origin[k] = c / 2;
+    REQUIRE(bvh.intersect(ray).triangle == t);
+
+    mesh::Bvh::Packet directions[3];
+    for (int j = 0; j < 3; j++) directions[j] = mesh::Bvh::Packet::Constant(ray.direction[j]);
+    REQUIRE(bvh.occluded(ray.origin, directions, INFINITY) == 0xff);
+  }
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include "read_off.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_normals.hpp"
+#include "mesh_simplify.hpp"
+#include "mesh_meshlet.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("MeshCache", "") {
+  auto source = std::filesystem::temp_directory_path() / "test_mesh_cache.off";
+  std::filesystem::copy_file(DATA_DIR "/screwdriver.off", source, std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::remove(MeshCache::path(source.string()));
+
+  std::vector<float> V;
+  std::vector<uint16_t> F;
+  REQUIRE(readOFF(source.string(), V, F));
+  std::vector<float> C(V.size());
+  mesh::normalize(V.data(), V.size() / 3);
+  mesh::colorFromBounds(V.data(), V.size() / 3, C.data());
+  std::vector<float> N(V.size());
+  mesh::computeNormals(F.data(), F.size(), V.data(), V.size() / 3, N.data());
+
+  REQUIRE_FALSE(MeshCache(source.string()));
+  {
+    MeshCache built = MeshCache::build(source.string(), V, C, N, F);
+    REQUIRE(built);
+    REQUIRE(built.header->vertexCount == 3395);
+  }
+
+  MeshCache cache(source.string());
+  REQUIRE(cache);
+  REQUIRE(cache.header->indexSize == sizeof(uint16_t));
+  REQUIRE(cache.header->indexCount == F.size());
+  REQUIRE(std::memcmp(cache.positions, V.data(), V.size() * sizeof(float)) == 0);
+  REQUIRE(std::memcmp(cache.colors, C.data(), C.size() * sizeof(float)) == 0);
+  REQUIRE(std::memcmp(cache.normals, N.data(), N.size() * sizeof(float)) == 0);
+  REQUIRE(std::memcmp(cache.indices, F.data(), F.size() * sizeof(uint16_t)) == 0);
+  for (int k = 0; k < 3; k++) {
+    REQUIRE(cache.header->boundsMin[k] < cache.header->boundsMax[k]);
+    REQUIRE(cache.header->boundsMin[k] >= -1.f);
+  }
+
+  // a source with a new timestamp but the same content still hits
+  std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::hours(1));
+  REQUIRE(MeshCache(source.string()));
+
+  // changed content misses
+  {
+    FILE* file = fopen(source.string().c_str(), "r+b");
+    fseek(file, 4, SEEK_SET);
+    fputc('7', file);
+    fclose(file);
+  }
+  REQUIRE_FALSE(MeshCache(source.string()));
+
+  std::filesystem::remove(MeshCache::path(source.string()));
+  std::filesystem::remove(source);
+}
+
+TEST_CASE("MeshCache::Writer", "") {
+  auto source = std::filesystem::temp_directory_path() / "test_mesh_cache_writer.off";
+  std::filesystem::copy_file(DATA_DIR "/screwdriver.off", source, std::filesystem::copy_options::overwrite_existing);
+
+  std::vector<float> V;
+  std::vector<uint16_t> F;
+  REQUIRE(readOFF(source.string(), V, F));
+  std::vector<float> C(V.size());
+  mesh::normalize(V.data(), V.size() / 3);
+  mesh::colorFromBounds(V.data(), V.size() / 3, C.data());
+  std::vector<float> N(V.size());
+  mesh::computeNormals(F.data(), F.size(), V.data(), V.size() / 3, N.data());
+
+  mesh::Stats stats;
+  auto onHeader = [](const off::Header&) { return true; };
+  REQUIRE(streamOFF<float, uint16_t>(source.string(), 500, onHeader,
+    [&](float* v, size_t n) { stats.add(v, n); return true; },
+    [](const uint16_t*, size_t) { return false; }));
+  REQUIRE(stats.count == 3395);
+
+  {
+    MeshCache::Writer writer(source.string(), 3395, F.size(), sizeof(uint16_t));
+    REQUIRE(writer);
+    std::vector<float> colors(500 * 3);
+    size_t streamed = 0;
+    REQUIRE(streamOFF<float, uint16_t>(source.string(), 500, onHeader,
+      [&](float* v, size_t n) {
+        mesh::normalizeBatch(stats, v, n, colors.data());
+        writer.positions(v, n);
+        writer.colors(colors.data(), n);
+        writer.normals(N.data() + streamed * 3, n);
+        streamed += n;
+        return true;
+      },
+      [&](const uint16_t* f, size_t n) {
+        writer.indices(f, n);
+        return true;
+      }));
+    float lo[3], hi[3];
+    stats.normalizedBounds(lo, hi);
+    REQUIRE(writer.finish(lo, hi));
+  }
+
+  MeshCache cache(source.string());
+  REQUIRE(cache);
+  REQUIRE(cache.header->vertexCount == 3395);
+  REQUIRE(std::memcmp(cache.indices, F.data(), F.size() * sizeof(uint16_t)) == 0);
+  for (size_t i = 0; i < V.size(); i++) {
+    REQUIRE(std::abs(cache.positions[i] - V[i]) < 1e-6);
+    REQUIRE(std::abs(cache.colors[i] - C[i]) < 1e-5);
+    REQUIRE(cache.normals[i] == N[i]);
+  }
+
+  std::filesystem::remove(MeshCache::path(source.string()));
+  std::filesystem::remove(source);
+}
+
+TEST_CASE("MeshCache levels of detail and meshlets", "") {
+  auto source = std::filesystem::temp_directory_path() / "test_mesh_cache_lods.off";
+  std::filesystem::copy_file(DATA_DIR "/screwdriver.off", source, std::filesystem::copy_options::overwrite_existing);
+
+  std::vector<float> V;
+  std::vector<uint16_t> F;
+  REQUIRE(readOFF(source.string(), V, F));
+  std::vector<float> C(V.size());
+  mesh::normalize(V.data(), V.size() / 3);
+  mesh::colorFromBounds(V.data(), V.size() / 3, C.data());
+  auto lods = mesh::buildLods(F, V.data(), V.size() / 3);
+  std::vector<uint16_t> grouped(F.size());
+  auto meshlets = mesh::buildMeshlets(F.data(), F.size(), V.data(), V.size() / 3, grouped.data());
+  MeshCache::build(source.string(), V, C, std::vector<float>(V.size()), grouped, {}, lods, meshlets);
+
+  MeshCache cache(source.string());
+  REQUIRE(cache);
+  REQUIRE(cache.header->clusterCount == 0);
+  REQUIRE(cache.header->lodCount == lods.size());
+  REQUIRE(cache.header->indexCount == F.size());
+  REQUIRE(std::memcmp(cache.lods, lods.data(), lods.size() * sizeof(mesh::Lod)) == 0);
+  REQUIRE(cache.header->meshletCount == meshlets.size());
+  REQUIRE(std::memcmp(cache.meshlets, meshlets.data(), meshlets.size() * sizeof(mesh::Meshlet)) == 0);
+
+  std::filesystem::remove(MeshCache::path(source.string()));
+  std::filesystem::remove(source);
+}
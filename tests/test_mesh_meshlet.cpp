@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <array>
+#include <set>
+#include "read_off.hpp"
+#include "math.hpp"
+#include "mesh.hpp"
+#include "mesh_meshlet.hpp"
+#include "mesh_optimize.hpp"
+#include "triangles.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("buildMeshlets", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F, remap;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+  mesh::normalize(V.data(), vertexCount);
+  mesh::optimize(F, V.data(), vertexCount, remap);
+  std::vector<float> W(V.size());
+  mesh::remapStream(V.data(), 3, remap, W.data());
+  V.swap(W);
+
+  std::vector<uint32_t> grouped(F.size());
+  auto meshlets = mesh::buildMeshlets(F.data(), F.size(), V.data(), vertexCount, grouped.data());
+  REQUIRE(test::triangles(grouped) == test::triangles(F));
+  // grouping loses the cache order, reordering inside the meshlets gets
+  // most of it back
+  float optimized = mesh::analyzeCache(F.data(), F.size(), vertexCount).acmr;
+  float meshletOrder = mesh::analyzeCache(grouped.data(), grouped.size(), vertexCount).acmr;
+  std::vector<uint32_t> reordered = grouped;
+  mesh::optimizeMeshlets(meshlets.data(), meshlets.size(), reordered.data());
+  float reorderedAcmr = mesh::analyzeCache(reordered.data(), reordered.size(), vertexCount).acmr;
+  REQUIRE(reorderedAcmr < meshletOrder);
+  REQUIRE(reorderedAcmr < optimized * 1.2f);
+  for (auto& m : meshlets) {
+    std::vector<uint32_t> a(grouped.begin() + m.firstIndex, grouped.begin() + m.firstIndex + m.indexCount);
+    std::vector<uint32_t> b(reordered.begin() + m.firstIndex, reordered.begin() + m.firstIndex + m.indexCount);
+    REQUIRE(test::triangles(a) == test::triangles(b));
+  }
+  F.swap(grouped);
+  REQUIRE(meshlets.size() > F.size() / 3 / 124);
+  uint32_t next = 0;
+  for (auto& m : meshlets) {
+    REQUIRE(m.firstIndex == next);
+    next += m.indexCount;
+    REQUIRE(m.indexCount % 3 == 0);
+    REQUIRE(m.indexCount / 3 <= 124);
+    std::set<uint32_t> vertices(F.begin() + m.firstIndex, F.begin() + m.firstIndex + m.indexCount);
+    REQUIRE(vertices.size() == m.vertexCount);
+    REQUIRE(m.vertexCount <= 64);
+
+    Eigen::Map<const Eigen::Vector3f> center(m.center), axis(m.coneAxis);
+    for (uint32_t v : vertices)
+      REQUIRE((Eigen::Map<const Eigen::Vector3f>(&V[v * 3]) - center).norm() <= m.radius * 1.0001f);
+    for (uint32_t i = m.firstIndex; i < m.firstIndex + m.indexCount; i += 3) {
+      Eigen::Map<const Eigen::Vector3f> a(&V[F[i] * 3]), b(&V[F[i + 1] * 3]), c(&V[F[i + 2] * 3]);
+      Eigen::Vector3f n = (b - a).cross(c - a);
+      if (n.squaredNorm() > 0) REQUIRE(axis.dot(n.normalized()) >= std::cos(m.coneAngle) - 1e-5f);
+    }
+  }
+  REQUIRE(next == F.size());
+
+  // a camera on the z axis looking at the mesh
+  Eigen::Matrix4f proj, view;
+  Eigen::Vector3f eye(0, 0, 5);
+  math::perspective(proj, math::radians(45), 16 / 9.f, .1f, 100.f);
+  math::lookAt(view, eye, Eigen::Vector3f(0, 0, -1), Eigen::Vector3f(0, 1, 0));
+  mesh::Frustum frustum = mesh::Frustum::fromMatrix(proj * view);
+
+  size_t drawn = 0;
+  uint32_t last = 0;
+  size_t visible = mesh::cullMeshlets(meshlets.data(), meshlets.size(), frustum, eye, [&](uint32_t first, uint32_t count) {
+    REQUIRE(first >= last);
+    last = first + count;
+    drawn += count;
+    });
+  REQUIRE(visible > 0);
+  REQUIRE(visible < meshlets.size());
+  REQUIRE(drawn < F.size());
+
+  // culled meshlets only have triangles facing away
+  for (auto& m : meshlets) {
+    if (!mesh::backfacing(m, eye)) continue;
+    for (uint32_t i = m.firstIndex; i < m.firstIndex + m.indexCount; i += 3) {
+      Eigen::Map<const Eigen::Vector3f> a(&V[F[i] * 3]), b(&V[F[i + 1] * 3]), c(&V[F[i + 2] * 3]);
+      REQUIRE((b - a).cross(c - a).dot(a - eye) >= 0);
+    }
+  }
+
+  // looking away nothing is left
+  math::lookAt(view, eye, Eigen::Vector3f(0, 0, 1), Eigen::Vector3f(0, 1, 0));
+  frustum = mesh::Frustum::fromMatrix(proj * view);
+  REQUIRE(mesh::cullMeshlets(meshlets.data(), meshlets.size(), frustum, eye, [](uint32_t, uint32_t) {}) == 0);
+}
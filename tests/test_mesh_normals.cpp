@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "primitive.hpp"
+#include "mesh.hpp"
+#include "mesh_normals.hpp"
+#include "mesh_weld.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("computeNormals", "") {
+  // the cube has a vertex per face corner and authored normals
+  auto cube = prim::generate(prim::Cube{});
+  std::vector<float> V, N;
+  std::vector<uint16_t> F = cube.indices;
+  for (auto& v : cube.vertices) V.insert(V.end(), v.position, v.position + 3);
+  N.resize(V.size());
+  for (auto weight : { mesh::NormalWeight::Area, mesh::NormalWeight::Angle }) {
+    mesh::computeNormals(F.data(), F.size(), V.data(), V.size() / 3, N.data(), weight, 2);
+    for (size_t v = 0; v < V.size() / 3; v++)
+      for (int k = 0; k < 3; k++) REQUIRE(std::abs(N[v * 3 + k] - cube.vertices[v].normal[k]) < 1e-6f);
+  }
+
+  // welded, every corner gets the diagonal when the three faces weigh the same
+  std::vector<uint32_t> welded(F.begin(), F.end()), remap;
+  REQUIRE(mesh::weld(welded.data(), welded.size(), V.data(), V.size() / 3, 0.f, remap).after == 8);
+  std::vector<float> corners(remap.size() * 3), normals(corners.size());
+  mesh::remapStream(V.data(), 3, remap, corners.data());
+  mesh::computeNormals(welded.data(), welded.size(), corners.data(), 8, normals.data(), mesh::NormalWeight::Angle);
+  for (size_t v = 0; v < 8; v++)
+    for (int k = 0; k < 3; k++)
+      REQUIRE(std::abs(normals[v * 3 + k] - std::copysign(1 / std::sqrt(3.f), corners[v * 3 + k])) < 1e-6f);
+
+  // every vertex of a closed scan gets a unit normal, also through the
+  // packet tail and on a single thread
+  std::vector<uint32_t> indices;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, indices));
+  N.assign(V.size(), 0.f);
+  mesh::computeNormals(indices.data(), indices.size() - 3 * 5, V.data(), V.size() / 3, N.data(), mesh::NormalWeight::Area, 1);
+  std::vector<float> parallel(V.size());
+  mesh::computeNormals(indices.data(), indices.size() - 3 * 5, V.data(), V.size() / 3, parallel.data());
+  REQUIRE(N == parallel);
+  for (size_t v = 0; v < V.size() / 3; v++) {
+    float length = Eigen::Map<Eigen::Vector3f>(&N[v * 3]).norm();
+    REQUIRE((std::abs(length - 1) < 1e-5f || length == 0));
+  }
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <array>
+#include <random>
+#include "read_off.hpp"
+#include "mesh.hpp"
+#include "mesh_optimize.hpp"
+#include "triangles.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("optimize", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+
+  // a scan-like random triangle order
+  std::vector<uint32_t> order(F.size() / 3), shuffled;
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(1));
+  for (uint32_t t : order) shuffled.insert(shuffled.end(), F.begin() + t * 3, F.begin() + t * 3 + 3);
+
+  auto before = mesh::analyzeCache(shuffled.data(), shuffled.size(), vertexCount);
+  REQUIRE(before.acmr > 2);
+
+  std::vector<uint32_t> tipsified(shuffled.size());
+  auto clusters = mesh::optimizeCache(shuffled.data(), shuffled.size(), vertexCount, tipsified.data());
+  REQUIRE(test::triangles(tipsified) == test::triangles(F));
+  REQUIRE(std::is_sorted(clusters.begin(), clusters.end()));
+  auto cache = mesh::analyzeCache(tipsified.data(), tipsified.size(), vertexCount);
+  REQUIRE(cache.acmr < 0.8f);
+
+  std::vector<uint32_t> sorted(shuffled.size());
+  mesh::optimizeOverdraw(tipsified.data(), tipsified.size(), V.data(), vertexCount, clusters, sorted.data());
+  REQUIRE(test::triangles(sorted) == test::triangles(F));
+  REQUIRE(mesh::analyzeCache(sorted.data(), sorted.size(), vertexCount).acmr <= cache.acmr * 1.1f);
+
+  std::vector<uint32_t> optimized = shuffled, remap;
+  mesh::optimize(optimized, V.data(), vertexCount, remap);
+  auto after = mesh::analyzeCache(optimized.data(), optimized.size(), vertexCount);
+  REQUIRE(after.acmr < before.acmr / 2);
+  REQUIRE(after.atvr < 1.5f);
+
+  // vertices are numbered by first use and map back to the same triangles
+  REQUIRE(remap.size() == vertexCount);
+  uint32_t next = 0;
+  for (uint32_t v : optimized) {
+    REQUIRE(v <= next);
+    next = std::max(next, v + 1);
+  }
+  std::vector<uint32_t> restored(optimized.size());
+  for (size_t i = 0; i < optimized.size(); i++) restored[i] = remap[optimized[i]];
+  REQUIRE(test::triangles(restored) == test::triangles(F));
+
+  std::vector<float> W(remap.size() * 3);
+  mesh::remapStream(V.data(), 3, remap, W.data());
+  REQUIRE(W[optimized[0] * 3] == V[restored[0] * 3]);
+}
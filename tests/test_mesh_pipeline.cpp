@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "mesh.hpp"
+#include "mesh_pipeline.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("statsOf", "") {
+  // the packets and the scalar tail agree with a plain loop
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t count = V.size() / 3 - 3;
+  mesh::Stats stats = mesh::statsOf(V.data(), count, 2);
+  REQUIRE(stats.count == count);
+  for (int k = 0; k < 3; k++) {
+    double sum = 0;
+    float lo = INFINITY, hi = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+      sum += V[i * 3 + k];
+      lo = std::min(lo, V[i * 3 + k]);
+      hi = std::max(hi, V[i * 3 + k]);
+    }
+    REQUIRE(std::abs(stats.sum[k] - sum) < 1e-6 * count);
+    REQUIRE(stats.lo[k] == lo);
+    REQUIRE(stats.hi[k] == hi);
+  }
+}
+
+TEST_CASE("Pipeline", "") {
+  mesh::MeshData data;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", data.positions, data.indices));
+  std::vector<float> V = data.positions, C(V.size());
+  mesh::normalize(V.data(), V.size() / 3);
+  mesh::colorFromBounds(V.data(), V.size() / 3, C.data());
+
+  // fused vertex passes match the functions one after the other
+  std::vector<std::string> names;
+  bool ok = mesh::Pipeline()
+    .then(mesh::passes::normalize())
+    .then(mesh::passes::colorFromBounds())
+    .run(data, 2, [&](const std::string& name, double) { names.push_back(name); });
+  REQUIRE(ok);
+  REQUIRE(names == std::vector<std::string>{ "normalize+colorFromBounds" });
+  REQUIRE(data.streams() == (mesh::Positions | mesh::Colors | mesh::Indices));
+  for (size_t i = 0; i < V.size(); i++) {
+    REQUIRE(std::abs(data.positions[i] - V[i]) < 1e-6f);
+    REQUIRE(std::abs(data.colors[i] - C[i]) < 1e-5f);
+  }
+
+  // remapping passes carry every stream along
+  mesh::WeldStats weld;
+  REQUIRE(mesh::Pipeline().then(mesh::passes::weld(0.f, &weld)).then(mesh::passes::optimize()).run(data));
+  REQUIRE(data.colors.size() == data.positions.size());
+  REQUIRE(weld.after <= weld.before);
+
+  // a pass that reads what nothing wrote fails before anything runs
+  std::vector<float> positions = data.positions;
+  ok = mesh::Pipeline().then(mesh::passes::normalize()).then(mesh::passes::occlusion()).run(data);
+  REQUIRE(!ok);
+  REQUIRE(data.positions == positions);
+}
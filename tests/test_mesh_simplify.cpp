@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "mesh.hpp"
+#include "mesh_simplify.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("simplify", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+  mesh::normalize(V.data(), vertexCount);
+
+  std::vector<uint32_t> out;
+  float error = mesh::simplify(F.data(), F.size(), V.data(), vertexCount, F.size() / 4, out);
+  REQUIRE(out.size() <= F.size() / 4);
+  REQUIRE(out.size() > 0);
+  REQUIRE(error > 0);
+  REQUIRE(error < 0.05f);
+  for (size_t i = 0; i < out.size(); i += 3) {
+    REQUIRE(out[i] < vertexCount);
+    REQUIRE(out[i] != out[i + 1]);
+    REQUIRE(out[i + 1] != out[i + 2]);
+    REQUIRE(out[i] != out[i + 2]);
+  }
+
+  // a flat grid collapses without error down to its corners
+  size_t n = 17;
+  std::vector<float> grid;
+  std::vector<uint32_t> cells;
+  for (size_t j = 0; j < n; j++)
+    for (size_t i = 0; i < n; i++) grid.insert(grid.end(), { float(i), float(j), 0.f });
+  for (size_t j = 0; j + 1 < n; j++)
+    for (size_t i = 0; i + 1 < n; i++) {
+      uint32_t a = uint32_t(j * n + i), b = a + 1, c = a + uint32_t(n), d = c + 1;
+      cells.insert(cells.end(), { a, b, d, a, d, c });
+    }
+  REQUIRE(mesh::simplify(cells.data(), cells.size(), grid.data(), n * n, 6, out) == 0);
+  REQUIRE(out.size() == 6);
+
+  // with two colors the columns on either side of the color edge stay
+  std::vector<float> colors(grid.size(), 0.f);
+  for (size_t v = 0; v < n * n; v++) colors[v * 3] = v % n < n / 2 ? 0.f : 1.f;
+  std::vector<uint32_t> colored;
+  mesh::Attributes attributes{ colors.data(), 3, 3, 1.f };
+  REQUIRE(mesh::simplify(cells.data(), cells.size(), grid.data(), n * n, 18, colored, attributes) == 0);
+  REQUIRE(colored.size() == 18);
+  bool kept[2] = { false, false };
+  for (uint32_t v : colored) {
+    size_t column = v % n;
+    REQUIRE((column == 0 || column == n / 2 - 1 || column == n / 2 || column == n - 1));
+    if (column == n / 2 - 1 || column == n / 2) kept[column - (n / 2 - 1)] = true;
+  }
+  REQUIRE(kept[0]);
+  REQUIRE(kept[1]);
+}
+
+TEST_CASE("buildLods", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3, count = F.size();
+  mesh::normalize(V.data(), vertexCount);
+
+  auto lods = mesh::buildLods(F, V.data(), vertexCount);
+  REQUIRE(lods.size() >= 4);
+  REQUIRE(lods[0].firstIndex == 0);
+  REQUIRE(lods[0].indexCount == count);
+  REQUIRE(lods[0].error == 0);
+  for (size_t i = 1; i < lods.size(); i++) {
+    REQUIRE(lods[i].firstIndex == lods[i - 1].firstIndex + lods[i - 1].indexCount);
+    REQUIRE(lods[i].indexCount < lods[i - 1].indexCount);
+    REQUIRE(lods[i].error >= lods[i - 1].error);
+  }
+  REQUIRE(F.size() == lods.back().firstIndex + lods.back().indexCount);
+  REQUIRE(lods.back().indexCount / 3 >= 256 / 2);
+
+  // a mesh far away gets a coarse level, up close the full one
+  REQUIRE(mesh::selectLod(lods.data(), lods.size(), 1e6f) == 0);
+  REQUIRE(mesh::selectLod(lods.data(), lods.size(), 1e-3f) == lods.size() - 1);
+  size_t middle = mesh::selectLod(lods.data(), lods.size(), 1 / lods[2].error);
+  REQUIRE(middle >= 2);
+  REQUIRE(middle < lods.size());
+}
@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+#include "read_off.hpp"
+#include "mesh.hpp"
+#include "mesh_weld.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("weld", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t vertexCount = V.size() / 3;
+
+  // one vertex per face corner, like some exporters write
+  std::vector<float> corners;
+  std::vector<uint32_t> split(F.size());
+  for (size_t i = 0; i < F.size(); i++) {
+    corners.insert(corners.end(), &V[F[i] * 3], &V[F[i] * 3 + 3]);
+    split[i] = uint32_t(i);
+  }
+
+  std::vector<uint32_t> exact = split, remap;
+  auto stats = mesh::weld(exact.data(), exact.size(), corners.data(), F.size(), 0.f, remap, 3);
+  REQUIRE(stats.before == F.size());
+  REQUIRE(stats.after == remap.size());
+  REQUIRE(stats.after <= vertexCount);
+  REQUIRE(stats.after > vertexCount * 9 / 10);
+  for (size_t i = 0; i < F.size(); i++) {
+    REQUIRE(exact[i] < stats.after);
+    REQUIRE(std::memcmp(&corners[remap[exact[i]] * 3], &V[F[i] * 3], 3 * sizeof(float)) == 0);
+  }
+  // kept vertices are the first of their group, in source order
+  REQUIRE(std::is_sorted(remap.begin(), remap.end()));
+  REQUIRE(remap[0] == 0);
+
+  // copies moved by less than epsilon still merge, and the result matches
+  // the exact weld of the unmoved copies
+  std::vector<float> jittered = corners;
+  for (size_t i = 0; i < jittered.size(); i++) jittered[i] += (i % 7) * 1e-7f - 3e-7f;
+  std::vector<uint32_t> near = split, nearRemap;
+  auto nearStats = mesh::weld(near.data(), near.size(), jittered.data(), F.size(), 1e-5f, nearRemap);
+  REQUIRE(nearStats.after == stats.after);
+  REQUIRE(near == exact);
+  REQUIRE(nearRemap == remap);
+
+  // no epsilon, no merge of moved copies
+  std::vector<uint32_t> apart = split;
+  REQUIRE(mesh::weld(apart.data(), apart.size(), jittered.data(), F.size(), 0.f, remap).after > stats.after);
+}
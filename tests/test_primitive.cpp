@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include "primitive.hpp"
+
+// what a primitive generates at compile time, and what it generates for
+// the same shape at runtime
+static constexpr auto cube = prim::generateStatic([] { return prim::Cube{ .size = .5f }; });
+static constexpr auto uvSphere = prim::generateStatic<prim::PositionNormalUv>([] { return prim::UvSphere{ .segments = 12, .rings = 6 }; });
+static constexpr auto icoSphere = prim::generateStatic([] { return prim::IcoSphere{ .radius = 2, .frequency = 3 }; });
+static constexpr auto cylinder = prim::generateStatic([] { return prim::Cylinder{ .segments = 10 }; });
+static constexpr auto torus = prim::generateStatic<prim::PositionNormal, uint32_t>([] { return prim::Torus{ .segments = 12, .sides = 8 }; });
+static constexpr auto grid = prim::generateStatic<prim::PositionNormalUv>([] { return prim::Grid{ .divisions = 4 }; });
+static constexpr auto gnomon = prim::generateStatic<prim::PositionColor>([] { return prim::Gnomon{ .size = 2 }; });
+
+static_assert(cube.vertices.size() == 24 && cube.indices.size() == 36);
+static_assert(gnomon.vertices[1].position[0] == 2 && gnomon.vertices[1].color[0] == 1);
+static_assert(icoSphere.vertices.size() == 92 && icoSphere.indices.size() == 540);
+
+template <typename Static, typename Shape>
+void requireSame(const Static& baked, const Shape& shape) {
+  auto mesh = prim::generate<typename decltype(baked.vertices)::value_type, typename decltype(baked.indices)::value_type>(shape);
+  REQUIRE(mesh.vertices.size() == baked.vertices.size());
+  REQUIRE(mesh.indices.size() == baked.indices.size());
+  for (size_t i = 0; i < mesh.indices.size(); i++) REQUIRE(mesh.indices[i] == baked.indices[i]);
+  REQUIRE(std::memcmp(mesh.vertices.data(), baked.vertices.data(), sizeof(baked.vertices)) == 0);
+}
+
+// Every index is in range, every vertex is used, and every triangle winds
+// counter-clockwise around the normals of its vertices.
+template <typename Mesh>
+void requireTriangles(const Mesh& mesh) {
+  REQUIRE(mesh.indices.size() % 3 == 0);
+  std::vector<bool> used(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+    Eigen::Vector3f p[3], n = Eigen::Vector3f::Zero();
+    for (int k = 0; k < 3; k++) {
+      auto& v = mesh.vertices.at(mesh.indices[i + k]);
+      used[mesh.indices[i + k]] = true;
+      p[k] = Eigen::Vector3f(v.position[0], v.position[1], v.position[2]);
+      n += Eigen::Vector3f(v.normal[0], v.normal[1], v.normal[2]);
+    }
+    Eigen::Vector3f face = (p[1] - p[0]).cross(p[2] - p[0]);
+    REQUIRE(face.norm() > 0);
+    REQUIRE(face.dot(n) > 0);
+  }
+  REQUIRE(std::find(used.begin(), used.end(), false) == used.end());
+}
+
+TEST_CASE("prim::sincos", "") {
+  for (double x = -7; x < 7; x += .01) {
+    double s, c;
+    prim::detail::sincos(x, s, c);
+    REQUIRE(std::abs(s - std::sin(x)) < 1e-14);
+    REQUIRE(std::abs(c - std::cos(x)) < 1e-14);
+  }
+  REQUIRE(std::abs(prim::detail::sqrt(2) - std::sqrt(2.)) < 1e-15);
+}
+
+TEST_CASE("prim::generate", "") {
+  requireSame(cube, prim::Cube{ .size = .5f });
+  requireSame(uvSphere, prim::UvSphere{ .segments = 12, .rings = 6 });
+  requireSame(icoSphere, prim::IcoSphere{ .radius = 2, .frequency = 3 });
+  requireSame(cylinder, prim::Cylinder{ .segments = 10 });
+  requireSame(torus, prim::Torus{ .segments = 12, .sides = 8 });
+  requireSame(grid, prim::Grid{ .divisions = 4 });
+  requireSame(gnomon, prim::Gnomon{ .size = 2 });
+
+  requireTriangles(cube);
+  requireTriangles(uvSphere);
+  requireTriangles(icoSphere);
+  requireTriangles(cylinder);
+  requireTriangles(torus);
+  requireTriangles(grid);
+  requireTriangles(prim::generate(prim::Cylinder{ .segments = 5, .caps = false }));
+
+  // spheres are on their radius, normals are unit length
+  for (auto& v : uvSphere.vertices) REQUIRE(std::abs(Eigen::Map<const Eigen::Vector3f>(v.position).norm() - 1) < 1e-6f);
+  for (auto& v : icoSphere.vertices) {
+    REQUIRE(std::abs(Eigen::Map<const Eigen::Vector3f>(v.position).norm() - 2) < 1e-6f);
+    REQUIRE(std::abs(Eigen::Map<const Eigen::Vector3f>(v.normal).norm() - 1) < 1e-6f);
+  }
+
+  // the geodesic sphere shares its vertices: all distinct, closed with
+  // V - E + F = 2
+  std::set<std::array<float, 3>> distinct;
+  for (auto& v : icoSphere.vertices) distinct.insert({ v.position[0], v.position[1], v.position[2] });
+  REQUIRE(distinct.size() == icoSphere.vertices.size());
+  std::set<std::pair<uint16_t, uint16_t>> edges;
+  for (size_t i = 0; i < icoSphere.indices.size(); i += 3)
+    for (int k = 0; k < 3; k++) {
+      uint16_t a = icoSphere.indices[i + k], b = icoSphere.indices[i + (k + 1) % 3];
+      edges.insert({ std::min(a, b), std::max(a, b) });
+    }
+  REQUIRE(icoSphere.vertices.size() - edges.size() + icoSphere.indices.size() / 3 == 2);
+
+  // runtime tessellations that do not fit the index type fail
+  REQUIRE(prim::generate<prim::Position, uint16_t>(prim::Grid{ .divisions = 256 }).vertices.empty());
+  REQUIRE(prim::generate<prim::Position, uint32_t>(prim::Grid{ .divisions = 256 }).vertices.size() == 257 * 257);
+}
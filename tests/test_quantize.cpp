@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "read_off.hpp"
+#include "mesh.hpp"
+#include "quantize.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("quantize", "") {
+  std::vector<float> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  size_t count = V.size() / 3;
+
+  float lo[3], hi[3];
+  mesh::bounds(V.data(), count, lo, hi);
+  auto bounds = quantize::Bounds::fromBox(lo, hi);
+
+  std::vector<int16_t> positions(count * 4);
+  quantize::encodePositions({ V.data(), 3 }, count, bounds, { positions.data(), 4 });
+  auto e = quantize::positionError({ V.data(), 3 }, { positions.data(), 4 }, count, bounds);
+  float step = *std::max_element(bounds.scale, bounds.scale + 3) / 32767;
+  REQUIRE(e.max <= step);
+  REQUIRE(e.rms <= e.max);
+  REQUIRE(positions[3] == 32767);
+
+  // unit normals, including the poles and the folded lower hemisphere
+  std::vector<float> normals{ 0, 0, 1, 0, 0, -1, 1, 0, 0, 0, -1, 0 };
+  for (size_t i = 0; i < count; i++) {
+    float n[3] = { V[i * 3], V[i * 3 + 1] - 0.01f, V[i * 3 + 2] };
+    float l = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int k = 0; k < 3; k++) normals.push_back(n[k] / l);
+  }
+  size_t normalCount = normals.size() / 3;
+  std::vector<int16_t> octahedral(normalCount * 2);
+  quantize::encodeNormals({ normals.data(), 3 }, normalCount, { octahedral.data(), 2 });
+  auto en = quantize::normalError({ normals.data(), 3 }, { octahedral.data(), 2 }, normalCount);
+  REQUIRE(en.max < 0.01);
+  float pole[3];
+  quantize::decodeNormal(octahedral.data() + 2, pole);
+  REQUIRE(pole[2] == -1.f);
+
+  // interleaved colors next to the normals
+  std::vector<float> colors(count * 3);
+  mesh::colorFromBounds(V.data(), count, colors.data());
+  std::vector<uint8_t> packed(count * 8);
+  quantize::encodeColors({ colors.data(), 3 }, count, { packed.data() + 4, 8 });
+  auto ec = quantize::colorError({ colors.data(), 3 }, { packed.data() + 4, 8 }, count);
+  REQUIRE(ec.max <= 0.5 / 255 + 1e-6);
+  REQUIRE(packed[7] == 255);
+  REQUIRE(packed[0] == 0);
+
+  REQUIRE(quantize::wgsl(bounds).find("fn decodeNormal") != std::string::npos);
+}
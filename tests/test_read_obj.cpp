@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include "read_off.hpp"
+#include "read_obj.hpp"
+
+#define DATA_DIR "../../data"
+
+TEST_CASE("readOBJ", "") {
+  std::vector<double> V0;
+  std::vector<uint32_t> F0;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V0, F0));
+
+  auto path = (std::filesystem::temp_directory_path() / "test_read_obj.obj").string();
+  {
+    FILE* file = fopen(path.c_str(), "w");
+    fprintf(file, "# screwdriver\no screwdriver\n");
+    for (size_t i = 0; i < V0.size(); i += 3)
+      fprintf(file, "v %.17g %.17g %.17g\nvn 0 0 1\n", V0[i], V0[i + 1], V0[i + 2]);
+    for (size_t i = 0; i < F0.size(); i += 3)
+      fprintf(file, "f %u//%u %u/%u %u\n", F0[i] + 1, F0[i] + 1, F0[i + 1] + 1, F0[i + 1] + 1, F0[i + 2] + 1);
+    fclose(file);
+  }
+  std::vector<double> V;
+  std::vector<uint32_t> F;
+  REQUIRE(readOBJ(path, V, F));
+  REQUIRE(V == V0);
+  REQUIRE(F == F0);
+
+  std::ofstream(path) <<
+    "mtllib mesh.mtl\n"
+    "v 0 0 0\n"
+    "v 1 0 0 1 0 0\n"
+    "vt 0.5 0.5\n"
+    "  v 1 1 0\n"
+    "v 0 1 0\n"
+    "g quad\n"
+    "usemtl red\n"
+    "s off\n"
+    "f -4 -3 -2 -1\n"
+    "f 1/1/1 2/1/1 3/1/1 \r\n"
+    "f 1 2\n";
+  std::vector<float> Vf;
+  std::vector<uint16_t> Ff;
+  REQUIRE(readOBJ(path, Vf, Ff));
+  REQUIRE(Vf == std::vector<float>{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 });
+  // the quad as a fan, the line dropped
+  REQUIRE(Ff == std::vector<uint16_t>{ 0, 1, 2, 0, 2, 3, 0, 1, 2 });
+
+  std::ofstream(path) << "v 0 0 0\nf 1 2 3\n";
+  REQUIRE_FALSE(readOBJ(path, Vf, Ff));
+  std::filesystem::remove(path);
+}
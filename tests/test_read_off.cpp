@@ -1,4 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include "read_off.hpp"
 
 #define DATA_DIR "../../data"
@@ -47,4 +49,172 @@ TEST_CASE("readOFF", "") {
   size_t nF = F.size();
   for (int i = 0, n = fLast.size(); i < n; i++)
     REQUIRE(std::abs(F[nF - n + i] - fLast[i]) < 1e-5);
-}
\ No newline at end of file
+}
+
+TEST_CASE("readOFFMapped", "") {
+  std::vector<float> V0, V1;
+  std::vector<uint16_t> F0, F1;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V0, F0));
+  REQUIRE(readOFFMapped(DATA_DIR "/screwdriver.off", V1, F1));
+
+  REQUIRE(V1.size() == 3395 * 3);
+  REQUIRE(F1.size() == 6786 * 3);
+  REQUIRE(V0 == V1);
+  REQUIRE(F0 == F1);
+}
+
+
+TEST_CASE("readOFFParallel", "") {
+  std::vector<float> V0, V1;
+  std::vector<uint16_t> F0, F1;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V0, F0));
+  for (unsigned threads : { 1, 2, 3, 8 }) {
+    REQUIRE(readOFFParallel(DATA_DIR "/screwdriver.off", V1, F1, threads));
+    REQUIRE(V0 == V1);
+    REQUIRE(F0 == F1);
+  }
+}
+
+TEST_CASE("readOFFParallel comments and polygons", "") {
+  auto path = std::filesystem::temp_directory_path() / "test_read_off_polygons.off";
+  std::ofstream(path) <<
+    "OFF\n"
+    "# comment\n"
+    "5 3 0\n"
+    "0 0 0\n"
+    "1 0 0 0 0 1\n"
+    "# comment\n"
+    "1 1 0\n"
+    "0 1 0\n"
+    "0.5 0.5 1\n"
+    "4 0 1 2 3\n"
+    "# comment\n"
+    "3 0 1 4 255 0 0\n"
+    "3 2 3 4\n";
+
+  std::vector<double> V0, V1, V2;
+  std::vector<uint32_t> F0, F1, F2;
+  REQUIRE(readOFF(path.string(), V0, F0));
+  REQUIRE(readOFFMapped(path.string(), V1, F1));
+  REQUIRE(readOFFParallel(path.string(), V2, F2));
+  std::filesystem::remove(path);
+
+  REQUIRE(F0 == std::vector<uint32_t>{ 0, 1, 2, 3, 0, 1, 4, 2, 3, 4 });
+  REQUIRE(V0.size() == 15);
+  REQUIRE(V0 == V1);
+  REQUIRE(V0 == V2);
+  REQUIRE(F0 == F1);
+  REQUIRE(F0 == F2);
+}
+
+TEST_CASE("readOFFLayout", "") {
+  auto path = std::filesystem::temp_directory_path() / "test_read_off_layout.off";
+  std::ofstream(path) <<
+    "CNOFF\n"
+    "3 1 0\n"
+    "0 0 0 0 0 1 255 0 51 255\n"
+    "# comment\n"
+    "1 0 0 0 1 0 0.5 0.25 1\n"
+    "0 1 0 1 0 0 0 255 0\n"
+    "3 0 1 2\n";
+
+  // interleaved position/color, normals dropped
+  std::vector<float> interleaved;
+  std::vector<uint16_t> F;
+  REQUIRE(readOFFLayout<float>(path.string(), [&](const off::Header& header) {
+    REQUIRE(header.hasNormals);
+    REQUIRE(header.hasColors);
+    interleaved.resize(header.numVertices * 6);
+    return off::VertexLayout<float>{ .position = { interleaved.data(), 6 }, .color = { interleaved.data() + 3, 6 } };
+    }, F));
+  REQUIRE(F == std::vector<uint16_t>{ 0, 1, 2 });
+  REQUIRE(interleaved == std::vector<float>{
+    0, 0, 0, 1, 0, 51 / 255.f,
+    1, 0, 0, 0.5f, 0.25f, 1,
+    0, 1, 0, 0, 1, 0 });
+
+  // split streams
+  std::vector<double> P, N, C;
+  std::vector<uint32_t> F1;
+  REQUIRE(readOFFLayout<double>(path.string(), [&](const off::Header& header) {
+    P.resize(header.numVertices * 3);
+    N.resize(P.size());
+    C.resize(P.size());
+    return off::VertexLayout<double>{ .position = { P.data() }, .normal = { N.data() }, .color = { C.data() } };
+    }, F1, 2));
+  REQUIRE(P == std::vector<double>{ 0, 0, 0, 1, 0, 0, 0, 1, 0 });
+  REQUIRE(N == std::vector<double>{ 0, 0, 1, 0, 1, 0, 1, 0, 0 });
+  REQUIRE(C[2] == 51 / 255.);
+  REQUIRE(C[4] == 0.25);
+  REQUIRE(C[6] == 0);
+
+  size_t colored = 0;
+  REQUIRE(streamOFF<float, uint16_t>(path.string(), 2,
+    [](const off::Header&) { return true; },
+    [&](float* v, float* c, size_t n) {
+      REQUIRE(c != nullptr);
+      for (size_t i = 0; i < n * 3; i++, colored++) REQUIRE(c[i] == interleaved[colored / 3 * 6 + 3 + colored % 3]);
+      REQUIRE(v[0] == interleaved[(colored / 3 - n) * 6]);
+      return true;
+    },
+    [](const uint16_t*, size_t) { return true; }));
+  REQUIRE(colored == 9);
+  std::filesystem::remove(path);
+
+  off::Header header;
+  REQUIRE(readOFFHeader(DATA_DIR "/screwdriver.off", header));
+  REQUIRE_FALSE(header.hasNormals);
+  REQUIRE_FALSE(header.hasColors);
+}
+
+TEST_CASE("streamOFF", "") {
+  std::vector<float> V0;
+  std::vector<uint16_t> F0;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V0, F0));
+
+  for (size_t blockSize : { 1 << 12, 1 << 20 }) {
+    std::vector<float> V;
+    std::vector<uint16_t> F;
+    size_t batches = 0;
+    REQUIRE(streamOFF<float, uint16_t>(DATA_DIR "/screwdriver.off", 1000,
+      [&](const off::Header& header) {
+        REQUIRE(header.numVertices == 3395);
+        REQUIRE(header.numFaces == 6786);
+        return true;
+      },
+      [&](float* v, size_t n) {
+        REQUIRE(n <= 1000);
+        V.insert(V.end(), v, v + n * 3);
+        batches++;
+        return true;
+      },
+      [&](const uint16_t* f, size_t n) {
+        REQUIRE(n <= 3000);
+        F.insert(F.end(), f, f + n);
+        batches++;
+        return true;
+      },
+      blockSize));
+    REQUIRE(batches == 4 + 7);
+    REQUIRE(V == V0);
+    REQUIRE(F == F0);
+  }
+
+  size_t vertices = 0;
+  REQUIRE(streamOFF<float, uint16_t>(DATA_DIR "/screwdriver.off", 1000,
+    [](const off::Header&) { return true; },
+    [&](float*, size_t n) { return (vertices += n) < 2000; },
+    [&](const uint16_t*, size_t) { return false; }));
+  REQUIRE(vertices == 2000);
+}
+
+TEST_CASE("readOFF narrowest index type", "") {
+  std::vector<float> V;
+  OFFIndices F;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V, F));
+  REQUIRE(std::holds_alternative<std::vector<uint16_t>>(F));
+  REQUIRE(std::get<std::vector<uint16_t>>(F).size() == 6786 * 3);
+
+  REQUIRE(fitsUint16(65536));
+  REQUIRE_FALSE(fitsUint16(65537));
+}
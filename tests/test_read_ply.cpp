@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "read_off.hpp"
+#include "read_ply.hpp"
+
+#define DATA_DIR "../../data"
+
+// writes V/F of a triangle mesh as a binary PLY, with `extra` float
+// properties after x y z and swapped bytes for big endian
+static void writePLY(const std::string& path, const std::vector<float>& V, const std::vector<uint32_t>& F,
+  int extra, bool bigEndian)
+{
+  std::ofstream out(path, std::ios::binary);
+  out << "ply\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+    << "comment test\n"
+    << "element vertex " << V.size() / 3 << "\n"
+    << "property float x\nproperty float y\nproperty float z\n";
+  for (int i = 0; i < extra; i++) out << "property float extra" << i << "\n";
+  out << "element face " << F.size() / 3 << "\n"
+    << "property list uchar int vertex_indices\n"
+    << "end_header\n";
+
+  auto write = [&](const void* data, size_t size) {
+    char bytes[8];
+    std::memcpy(bytes, data, size);
+    if (bigEndian) std::reverse(bytes, bytes + size);
+    out.write(bytes, size);
+  };
+  for (size_t i = 0; i < V.size(); i += 3) {
+    for (int k = 0; k < 3; k++) write(&V[i + k], 4);
+    for (int k = 0; k < extra; k++) write(&V[i], 4);
+  }
+  for (size_t i = 0; i < F.size(); i += 3) {
+    uint8_t n = 3;
+    write(&n, 1);
+    for (int k = 0; k < 3; k++) write(&F[i + k], 4);
+  }
+}
+
+TEST_CASE("readPLY", "") {
+  std::vector<float> V0;
+  std::vector<uint32_t> F0;
+  REQUIRE(readOFF(DATA_DIR "/screwdriver.off", V0, F0));
+
+  auto path = (std::filesystem::temp_directory_path() / "test_read_ply.ply").string();
+  for (auto [extra, bigEndian] : { std::pair{ 0, false }, { 3, false }, { 0, true } }) {
+    writePLY(path, V0, F0, extra, bigEndian);
+
+    std::vector<float> V;
+    std::vector<uint16_t> F;
+    REQUIRE(readPLY(path, V, F));
+    REQUIRE(V == V0);
+    REQUIRE(std::equal(F.begin(), F.end(), F0.begin(), F0.end()));
+
+    std::vector<double> Vd;
+    std::vector<uint32_t> Fd;
+    REQUIRE(readPLY(path, Vd, Fd));
+    REQUIRE(std::equal(Vd.begin(), Vd.end(), V0.begin(), V0.end()));
+    REQUIRE(Fd == F0);
+  }
+
+  std::ofstream(path) <<
+    "ply\n"
+    "format ascii 1.0\n"
+    "element vertex 4\n"
+    "property float x\n"
+    "property float y\n"
+    "property float z\n"
+    "property uchar red\n"
+    "element face 3\n"
+    "property list uchar int vertex_indices\n"
+    "property uchar flags\n"
+    "element edge 1\n"
+    "property int vertex1\n"
+    "property int vertex2\n"
+    "end_header\n"
+    "0 0 0 255\n"
+    "1 0 0 0\n"
+    "1 1 0 0\n"
+    "0 1 0.5 0\n"
+    "4 0 1 2 3 7\n"
+    "3 0 2 3 0\n"
+    "2 0 1 0\n"
+    "0 1\n";
+  std::vector<float> V;
+  std::vector<int> F;
+  REQUIRE(readPLY(path, V, F));
+  REQUIRE(V == std::vector<float>{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0.5f });
+  // the quad as a fan, the line dropped
+  REQUIRE(F == std::vector<int>{ 0, 1, 2, 0, 2, 3, 0, 2, 3 });
+
+  // truncated binary body
+  writePLY(path, V0, F0, 0, false);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+  REQUIRE_FALSE(readPLY(path, V, F));
+  std::filesystem::remove(path);
+}
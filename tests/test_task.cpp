@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include "task.hpp"
+
+TEST_CASE("task", "") {
+  task::Queue frames;
+  std::thread::id worker, main = std::this_thread::get_id();
+  int stage = 0;
+  task::Task failing;
+  {
+    task::Pool workers(2);
+    auto load = [&]() -> task::Task {
+      co_await workers.schedule();
+      worker = std::this_thread::get_id();
+      stage = 1;
+      co_await frames.schedule();
+      REQUIRE(std::this_thread::get_id() == main);
+      stage = 2;
+    };
+    task::Task t = load();
+    REQUIRE_FALSE(t.done());
+
+    // frames keep running while the worker stage is in flight
+    while (!t.done()) frames.run();
+    REQUIRE(stage == 2);
+    REQUIRE(worker != main);
+    t.rethrow();
+
+    auto fail = [&]() -> task::Task {
+      co_await workers.schedule();
+      throw std::runtime_error("load failed");
+    };
+    failing = fail();
+    while (!failing.done()) std::this_thread::yield();
+  }
+  REQUIRE_THROWS_AS(failing.rethrow(), std::runtime_error);
+  failing.rethrow();
+
+  // a coroutine still pending when its pool stops is dropped, not resumed
+  bool resumed = false;
+  task::Task first, dropped;
+  {
+    task::Pool workers(1);
+    auto block = [&]() -> task::Task {
+      co_await workers.schedule();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    };
+    auto pending = [&]() -> task::Task {
+      co_await workers.schedule();
+      resumed = true;
+    };
+    first = block();
+    dropped = pending();
+  }
+  REQUIRE_FALSE(resumed);
+  REQUIRE_FALSE(dropped.done());
+}
@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+#include "upload.hpp"
+
+namespace {
+  // stands in for the GPU: lands the copies of a batch in order
+  struct Replay {
+    upload::Batch batch;
+    std::vector<uint8_t> staging;
+    std::vector<uint8_t> buffer;
+    size_t submits = 0;
+
+    Replay(uint64_t capacity, size_t size) : batch{ capacity }, staging(capacity), buffer(size) {
+      batch.data = staging.data();
+    }
+
+    void submit() {
+      for (auto& copy : batch.copies)
+        memcpy(buffer.data() + copy.dstOffset, staging.data() + copy.srcOffset, copy.size);
+      batch.copies.clear();
+      batch.used = 0;
+      submits++;
+    }
+
+    void write(uint64_t offset, const std::vector<uint8_t>& data) {
+      batch.write(buffer.data(), offset, data.data(), data.size(), [this] { submit(); });
+    }
+  };
+}
+
+TEST_CASE("upload", "") {
+  SECTION("coalesce") {
+    Replay r(64, 64);
+    r.write(0, std::vector<uint8_t>(8, 1));
+    r.write(8, std::vector<uint8_t>(8, 2));
+    r.write(4, std::vector<uint8_t>(4, 3));
+    REQUIRE(r.batch.copies.size() == 1);
+    REQUIRE(r.batch.used == 16);
+    r.submit();
+    REQUIRE(r.buffer[0] == 1);
+    REQUIRE(r.buffer[4] == 3);
+    REQUIRE(r.buffer[8] == 2);
+  }
+
+  SECTION("oversized write after a staged one") {
+    Replay r(16, 64);
+    r.write(8, std::vector<uint8_t>(8, 1));
+    std::vector<uint8_t> big(48);
+    for (size_t i = 0; i < big.size(); i++) big[i] = uint8_t(i + 2);
+    r.write(0, big);
+    r.submit();
+    for (size_t i = 0; i < big.size(); i++) REQUIRE(r.buffer[i] == big[i]);
+    REQUIRE(r.submits >= 3);
+  }
+
+  SECTION("staged write after an oversized one") {
+    Replay r(16, 64);
+    r.write(0, std::vector<uint8_t>(40, 1));
+    r.write(32, std::vector<uint8_t>(8, 2));
+    r.submit();
+    REQUIRE(r.buffer[0] == 1);
+    REQUIRE(r.buffer[31] == 1);
+    REQUIRE(r.buffer[32] == 2);
+    REQUIRE(r.buffer[39] == 2);
+  }
+}
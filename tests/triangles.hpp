@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Helpers shared by the mesh tests.
+namespace test {
+  // triangles as sorted vertex triples, independent of order and rotation
+  inline std::vector<std::array<uint32_t, 3>> triangles(const std::vector<uint32_t>& F) {
+    std::vector<std::array<uint32_t, 3>> out;
+    for (size_t i = 0; i < F.size(); i += 3) {
+      std::array<uint32_t, 3> t{ F[i], F[i + 1], F[i + 2] };
+      std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+      out.push_back(t);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  }
+}